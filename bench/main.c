@@ -0,0 +1,648 @@
+// Benchmarks of the hot paths, each checked against a plain reference version while it runs
+//
+// Usage: bench [string] [layout] [bsp] [switch] [nearest]
+// Runs every benchmark, or only the named ones. Exits with 1 if a check failed.
+// Build it with `./build.sh bench release`, debug builds time the sanitizers.
+
+// memmem, the reference of StrFindSubStr
+#define _GNU_SOURCE
+#include "../core/core.h"
+#include "../wm/monitor.h"
+
+#include "../core/core.c"
+#include "../wm/bsp.c"
+#include "../wm/workspace.c"
+#include "../wm/monitor.c"
+#include "../wm/window.c"
+
+// Roughly this many bytes are processed per measurement, short inputs get more repetitions
+#define BENCH_BYTES Megabytes(256)
+// Roughly this many windows are laid out per measurement
+#define BENCH_WINDOWS Million(4)
+
+// Results feed it so the measured expressions aren't optimized out
+volatile u64 g_bench_sink;
+
+/*
+Average nanoseconds per evaluation of expr over iterations evaluations. The barrier keeps
+the compiler from hoisting the loop invariant expression out of the loop.
+*/
+#define BenchNs(ns, iterations, expr)                                                              \
+  do                                                                                               \
+  {                                                                                                \
+    u64 _bench_start = TimeNow();                                                                  \
+    for (u64 _bench_i = 0; _bench_i < (iterations); _bench_i += 1)                                 \
+    {                                                                                              \
+      __asm__ volatile("" ::: "memory");                                                           \
+      g_bench_sink += (u64)(expr);                                                                 \
+    }                                                                                              \
+    (ns) = (f64)(TimeNow() - _bench_start) / (f64)(iterations);                                    \
+  } while (0)
+
+typedef bool BenchFunc(Arena *arena);
+
+typedef struct
+{
+  const char *name;
+  BenchFunc  *func;
+} Bench;
+
+internal bool BenchIsSpace(u8 c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/*
+The byte loop StrTrimSpaces replaced
+*/
+internal String BenchTrimSpacesScalar(String s)
+{
+  u64 start = 0;
+  u64 end   = s.size;
+  while (start < end && BenchIsSpace(s.data[start]))
+  {
+    start += 1;
+  }
+  while (end > start && BenchIsSpace(s.data[end - 1]))
+  {
+    end -= 1;
+  }
+  return StrSubstr(s, start, end);
+}
+
+/*
+StrIndexByte against memchr and StrFindSubStr against memmem with the match at the very end,
+StrTrimSpaces against the byte loop on spaces and tabs around a single kept byte
+*/
+internal bool BenchString(Arena *arena)
+{
+  Allocator allocator = ArenaAllocator(arena);
+  bool      ok        = true;
+  u64       sizes[]   = {16, 64, 256, 4096, 65536};
+  printf("%8s %14s %10s %14s %10s %14s %12s  (ns)\n", "bytes", "StrIndexByte", "memchr",
+         "StrFindSubStr", "memmem", "StrTrimSpaces", "scalar trim");
+  for (u32 s = 0; s < sizeof sizes / sizeof sizes[0]; s += 1)
+  {
+    u64    size       = sizes[s];
+    u64    iterations = BENCH_BYTES / (size + 64);
+    String text       = {.data = Alloc(u8, size), .size = size};
+    for (u64 i = 0; i < size; i += 1)
+    {
+      text.data[i] = (u8)('a' + i % 23);
+    }
+    memcpy(text.data + size - 3, "xy#", 3);
+    String needle = StrLit("xy#");
+    String spaces = {.data = Alloc(u8, size), .size = size};
+    for (u64 i = 0; i < size; i += 1)
+    {
+      spaces.data[i] = (u8)" \t"[i & 1];
+    }
+    spaces.data[size / 2] = 'x';
+
+    u8  *found_byte   = memchr(text.data, '#', size);
+    u8  *found_needle = memmem(text.data, size, needle.data, needle.size);
+    bool agree =
+        StrIndexByte(text, '#') == found_byte - text.data &&
+        StrFindSubStr(text, needle, 0) == (u64)(found_needle - text.data) &&
+        StrEquals(StrTrimSpaces(spaces), BenchTrimSpacesScalar(spaces));
+    if (!agree)
+    {
+      Errorf("Bench: string results differ from the libc ones at %llu bytes",
+             (unsigned long long)size);
+      ok = false;
+    }
+
+    f64 index_ns, memchr_ns, find_ns, memmem_ns, trim_ns, trim_scalar_ns;
+    BenchNs(index_ns, iterations, StrIndexByte(text, '#'));
+    BenchNs(memchr_ns, iterations, (u8 *)memchr(text.data, '#', size) - text.data);
+    BenchNs(find_ns, iterations, StrFindSubStr(text, needle, 0));
+    BenchNs(memmem_ns, iterations,
+            (u8 *)memmem(text.data, size, needle.data, needle.size) - text.data);
+    BenchNs(trim_ns, iterations, StrTrimSpaces(spaces).size);
+    BenchNs(trim_scalar_ns, iterations, BenchTrimSpacesScalar(spaces).size);
+    printf("%8llu %14.1f %10.1f %14.1f %10.1f %14.1f %12.1f\n", (unsigned long long)size,
+           index_ns, memchr_ns, find_ns, memmem_ns, trim_ns, trim_scalar_ns);
+  }
+  return ok;
+}
+
+// A 2560x1440 monitor, a third of it per column until they overflow into a scrolling strip
+const StyleConfig g_bench_style = {
+    .minimum_width_tiling_window           = 200,
+    .default_width_percent_available_width = 0.333,
+    .border_width                          = 2,
+    .inner_gap                             = 8,
+    .outer_gap_horizontal                  = 8,
+    .outer_gap_vertical                    = 8,
+};
+const Rect g_bench_monitor = {0, 0, 2560, 1440};
+// Every new window splits the newest one, the tree is a chain as deep as there are windows. The
+// workspace is as large as X allows so the deepest leaves still get more than a pixel.
+const StyleConfig g_bench_bsp_style = {
+    .border_width         = 2,
+    .inner_gap            = 0,
+    .outer_gap_horizontal = 8,
+    .outer_gap_vertical   = 8,
+    .layout               = LayoutKind_Bsp,
+};
+const Rect g_bench_bsp_monitor = {0, 0, INT16_MAX, INT16_MAX};
+
+// 50 columns that all fit the monitor, a switch moves every one of them
+const StyleConfig g_bench_switch_style = {
+    .minimum_width_tiling_window           = 1,
+    .default_width_percent_available_width = 0.01,
+    .border_width                          = 2,
+    .inner_gap                             = 8,
+    .outer_gap_horizontal                  = 8,
+    .outer_gap_vertical                    = 8,
+};
+
+// xorshift64, fixed seed so every run checks the same sequences
+u64 g_bench_random = 88172645463325252ull;
+
+internal u64 BenchRandom()
+{
+  g_bench_random ^= g_bench_random << 13;
+  g_bench_random ^= g_bench_random >> 7;
+  g_bench_random ^= g_bench_random << 17;
+  return g_bench_random;
+}
+
+/*
+Pushes a window and appends it to the tiled windows of the workspace, returns its index
+*/
+internal u16 BenchAddWindow(Allocator allocator, WindowsSystem *windows, Workspace *workspace,
+                            xcb_window_t id)
+{
+  WindowsSystemPush(allocator, windows, id, 0, 0, 1, 1);
+  u16 index              = windows->size - 1;
+  windows->borders[index] = (u16)g_bench_style.border_width;
+  WorkspaceAddWindow(allocator, workspace, windows, index, WindowList_NormalMapped);
+  return index;
+}
+
+internal void BenchRemoveWindow(WindowsSystem *windows, Workspace *workspace, xcb_window_t id)
+{
+  i32 index = WindowsSystemFind(windows, id);
+  WorkspaceRemoveWindow(workspace, windows, (u16)index);
+  WindowsSystemUnorderedRemove(windows, (u16)index);
+}
+
+/*
+True if the geometry the incremental passes left behind is what laying out every window again
+gives, the workspace is laid out in full either way. The layout must not switch kinds, the
+copies are given back to the arena.
+*/
+internal bool BenchMatchesFullLayout(Arena *arena, Workspace *workspace, const StyleConfig *style,
+                                     WindowsSystem *windows)
+{
+  Allocator allocator = ArenaAllocator(arena);
+  WorkspaceLayout(allocator, workspace, style, windows);
+  Temp temp    = TempBegin(arena);
+  u64  size    = windows->size;
+  i16 *xs      = Alloc(i16, size);
+  i16 *ys      = Alloc(i16, size);
+  u16 *widths  = Alloc(u16, size);
+  u16 *heights = Alloc(u16, size);
+  memcpy(xs, windows->xs, sizeof(i16) * size);
+  memcpy(ys, windows->ys, sizeof(i16) * size);
+  memcpy(widths, windows->widths, sizeof(u16) * size);
+  memcpy(heights, windows->heights, sizeof(u16) * size);
+  WorkspaceInvalidate(workspace);
+  WorkspaceLayout(allocator, workspace, style, windows);
+  bool res = memcmp(xs, windows->xs, sizeof(i16) * size) == 0 &&
+             memcmp(ys, windows->ys, sizeof(i16) * size) == 0 &&
+             memcmp(widths, windows->widths, sizeof(u16) * size) == 0 &&
+             memcmp(heights, windows->heights, sizeof(u16) * size) == 0;
+  TempEnd(temp);
+  return res;
+}
+
+/*
+Columns layout of 1, 100 and 1000 windows: every window laid out again, a window opened and
+closed at the end of the strip, and a pass with nothing to do
+*/
+internal bool BenchLayout(Arena *arena)
+{
+  Allocator allocator = ArenaAllocator(arena);
+  bool      ok        = true;
+  u32       counts[]  = {1, 100, 1000};
+  printf("%8s %12s %16s %14s %12s  (ns)\n", "windows", "full", "open+close", "laid out/op",
+         "clean");
+  for (u32 c = 0; c < sizeof counts / sizeof counts[0]; c += 1)
+  {
+    u32           count      = counts[c];
+    u64           iterations = BENCH_WINDOWS / count;
+    WindowsSystem windows    = WindowsSystemInit(allocator, (u16)(count + 1));
+    Workspace     workspace  = WorkspaceInit(0, g_bench_monitor);
+    for (u32 i = 0; i < count; i += 1)
+    {
+      BenchAddWindow(allocator, &windows, &workspace, 0x400000 + i);
+    }
+    WorkspaceLayout(allocator, &workspace, &g_bench_style, &windows);
+
+    f64 full_ns;
+    BenchNs(full_ns, iterations,
+            (WorkspaceInvalidate(&workspace),
+             WorkspaceLayout(allocator, &workspace, &g_bench_style, &windows)));
+    u64 laid_out = 0;
+    u64 start    = TimeNow();
+    for (u64 i = 0; i < iterations; i += 1)
+    {
+      xcb_window_t id = 0x800000;
+      BenchAddWindow(allocator, &windows, &workspace, id);
+      laid_out += WorkspaceLayout(allocator, &workspace, &g_bench_style, &windows);
+      BenchRemoveWindow(&windows, &workspace, id);
+      laid_out += WorkspaceLayout(allocator, &workspace, &g_bench_style, &windows);
+    }
+    f64 open_close_ns = (f64)(TimeNow() - start) / (f64)iterations;
+    f64 clean_ns;
+    BenchNs(clean_ns, iterations,
+            WorkspaceLayout(allocator, &workspace, &g_bench_style, &windows));
+
+    if (!BenchMatchesFullLayout(arena, &workspace, &g_bench_style, &windows))
+    {
+      Errorf("Bench: incremental columns layout of %u windows differs from a full one", count);
+      ok = false;
+    }
+    printf("%8u %12.1f %16.1f %14.1f %12.1f\n", count, full_ns, open_close_ns,
+           (f64)laid_out / (f64)iterations, clean_ns);
+  }
+  return ok;
+}
+
+/*
+BSP layout of trees 10, 100 and 1000 deep: every leaf laid out again against a window opened and
+closed at the deepest leaf and a resize there, which only compute the subtree whose rect
+changed. A random run of opens, closes, focus changes and resizes then checks every incremental
+pass against a full one.
+*/
+internal bool BenchBsp(Arena *arena)
+{
+  Allocator allocator = ArenaAllocator(arena);
+  bool      ok        = true;
+  u32       counts[]  = {10, 100, 1000};
+  printf("%8s %12s %16s %14s %12s %14s  (ns)\n", "depth", "full", "open+close", "laid out/op",
+         "resize", "laid out/op");
+  for (u32 c = 0; c < sizeof counts / sizeof counts[0]; c += 1)
+  {
+    u32           count      = counts[c];
+    u64           iterations = BENCH_WINDOWS / count;
+    WindowsSystem windows    = WindowsSystemInit(allocator, (u16)(count + 1));
+    Workspace     workspace  = WorkspaceInit(0, g_bench_bsp_monitor);
+    WorkspaceLayout(allocator, &workspace, &g_bench_bsp_style, &windows);
+    for (u32 i = 0; i < count; i += 1)
+    {
+      BenchAddWindow(allocator, &windows, &workspace, 0x400000 + i);
+    }
+    WorkspaceLayout(allocator, &workspace, &g_bench_bsp_style, &windows);
+
+    f64 full_ns;
+    BenchNs(full_ns, iterations,
+            (WorkspaceInvalidate(&workspace),
+             WorkspaceLayout(allocator, &workspace, &g_bench_bsp_style, &windows)));
+    u64 deepest       = workspace.focused;
+    u64 open_laid_out = 0;
+    u64 start         = TimeNow();
+    for (u64 i = 0; i < iterations; i += 1)
+    {
+      xcb_window_t id = 0x800000;
+      BenchAddWindow(allocator, &windows, &workspace, id);
+      open_laid_out += WorkspaceLayout(allocator, &workspace, &g_bench_bsp_style, &windows);
+      BenchRemoveWindow(&windows, &workspace, id);
+      WorkspaceFocus(&workspace, deepest);
+      open_laid_out += WorkspaceLayout(allocator, &workspace, &g_bench_bsp_style, &windows);
+    }
+    f64 open_close_ns   = (f64)(TimeNow() - start) / (f64)iterations;
+    u64 resize_laid_out = 0;
+    start               = TimeNow();
+    for (u64 i = 0; i < iterations; i += 1)
+    {
+      WorkspaceResize(&workspace, (i & 1) ? Axis_Horizontal : Axis_Vertical,
+                      (i & 2) ? 15 : -15);
+      resize_laid_out += WorkspaceLayout(allocator, &workspace, &g_bench_bsp_style, &windows);
+    }
+    f64 resize_ns = (f64)(TimeNow() - start) / (f64)iterations;
+
+    if (!BenchMatchesFullLayout(arena, &workspace, &g_bench_bsp_style, &windows))
+    {
+      Errorf("Bench: incremental BSP layout %u deep differs from a full one", count);
+      ok = false;
+    }
+    printf("%8u %12.1f %16.1f %14.1f %12.1f %14.1f\n", count, full_ns, open_close_ns,
+           (f64)open_laid_out / (f64)iterations, resize_ns,
+           (f64)resize_laid_out / (f64)iterations);
+  }
+
+  // Up to 300 windows on a monitor sized workspace, so splits also bottom out at a pixel
+  WindowsSystem windows   = WindowsSystemInit(allocator, 64);
+  Workspace     workspace = WorkspaceInit(0, g_bench_monitor);
+  StyleConfig   style     = g_bench_bsp_style;
+  style.inner_gap         = 5;
+  WorkspaceLayout(allocator, &workspace, &style, &windows);
+  u32 steps   = 200000;
+  u32 checked = 0;
+  u32 next_id = 0x400000;
+  for (u32 step = 0; ok && step < steps; step += 1)
+  {
+    ArrayWindowId *tiled = &workspace.normal_mapped_windows;
+    u64            op    = BenchRandom() % 10;
+    if (op < 4 || tiled->size == 0)
+    {
+      BenchAddWindow(allocator, &windows, &workspace, next_id);
+      next_id += 1;
+    }
+    else if (op < 7)
+    {
+      BenchRemoveWindow(&windows, &workspace, tiled->data[BenchRandom() % tiled->size]);
+    }
+    else if (op < 9)
+    {
+      WorkspaceFocus(&workspace, BenchRandom() % tiled->size);
+    }
+    else
+    {
+      WorkspaceResize(&workspace, (Axis)(BenchRandom() % 2), (i32)(BenchRandom() % 61) - 30);
+    }
+    if (tiled->size > 300)
+    {
+      BenchRemoveWindow(&windows, &workspace, tiled->data[0]);
+    }
+    if (BenchRandom() % 3 == 0)
+    {
+      if (!BenchMatchesFullLayout(arena, &workspace, &style, &windows))
+      {
+        Errorf("Bench: incremental BSP layout differs from a full one after step %u", step);
+        ok = false;
+      }
+      checked += 1;
+    }
+  }
+  printf("%u random steps, %u incremental passes matched a full one\n", steps, checked);
+  return ok;
+}
+
+/*
+What Xcb_QueueLayout does after the layout pass, without the requests: returns the number of
+ConfigureWindow requests the geometry diff would send and adds up their size in bytes
+*/
+internal u64 BenchGeometryDiff(WindowsSystem *windows, u64 *bytes)
+{
+  u64                  sent = 0;
+  WindowGeometryChange changes[64];
+  u16                  from = 0;
+  u16                  count;
+  do
+  {
+    count = WindowsSystemGeometryChanges(windows, &from, changes, 64);
+    for (u16 i = 0; i < count; i += 1)
+    {
+      // 12 byte request, then a 4 byte value per mask bit
+      *bytes += 12 + 4 * (u64)__builtin_popcount(changes[i].value_mask);
+      WindowsSystemMarkSent(windows, changes[i].index);
+      sent += 1;
+    }
+  } while (count == 64);
+  return sent;
+}
+
+internal u64 BenchLayoutMonitor(Allocator allocator, const StyleConfig *style,
+                                WindowsSystem *windows)
+{
+  u64             res        = 0;
+  ArrayWorkspace *workspaces = MonitorWorkspaces(0);
+  for (u64 i = 0; i < workspaces->size; i += 1)
+  {
+    res += WorkspaceLayout(allocator, &workspaces->data[i], style, windows);
+  }
+  return res;
+}
+
+/*
+Switching between two workspaces of 50 tiled windows each: the switch, the layout pass and the
+geometry diff that follow it, up to where the requests would be flushed. Then the same with the
+shown workspace laid out again in full, what a switch costs without the parked geometry.
+*/
+internal bool BenchSwitch(Arena *arena)
+{
+  Allocator     allocator = ArenaAllocator(arena);
+  bool          ok        = true;
+  u32           count     = 50;
+  u64           switches  = 100000;
+  WindowsSystem windows   = WindowsSystemInit(allocator, (u16)(2 * count));
+  AddMonitor(allocator, StrId_None, true, 0, g_bench_monitor.x, g_bench_monitor.y,
+             g_bench_monitor.width, g_bench_monitor.height);
+  MonitorWorkspace(allocator, 0, 1);
+  for (u16 w = 0; w < 2; w += 1)
+  {
+    for (u32 i = 0; i < count; i += 1)
+    {
+      BenchAddWindow(allocator, &windows, MonitorWorkspace(allocator, 0, w),
+                     0x400000 + w * 0x1000 + i);
+    }
+  }
+  u64 bytes = 0;
+  BenchLayoutMonitor(allocator, &g_bench_switch_style, &windows);
+  BenchGeometryDiff(&windows, &bytes);
+
+  u64 laid_out = 0;
+  u64 sent     = 0;
+  bytes        = 0;
+  u64 start    = TimeNow();
+  for (u64 i = 0; i < switches; i += 1)
+  {
+    MonitorSwitchWorkspace(allocator, 0, (u16)((i + 1) & 1), &windows);
+    laid_out += BenchLayoutMonitor(allocator, &g_bench_switch_style, &windows);
+    sent += BenchGeometryDiff(&windows, &bytes);
+  }
+  f64 switch_ns = (f64)(TimeNow() - start) / (f64)switches;
+  printf("%-24s %10.1f ns, %5.1f windows laid out, %5.1f configures, %6.1f bytes per switch\n",
+         "switch", switch_ns, (f64)laid_out / (f64)switches, (f64)sent / (f64)switches,
+         (f64)bytes / (f64)switches);
+
+  // The shown workspace is where a full pass puts it, the hidden one is parked off screen
+  u16        active = MonitorActiveWorkspace(0);
+  Workspace *shown  = MonitorWorkspace(allocator, 0, active);
+  Workspace *hidden = MonitorWorkspace(allocator, 0, (u16)(active ^ 1));
+  if (!BenchMatchesFullLayout(arena, shown, &g_bench_switch_style, &windows))
+  {
+    Errorf("Bench: workspace %u isn't laid out like a full pass after the switches", active);
+    ok = false;
+  }
+  for (u64 i = 0; i < hidden->normal_mapped_windows.size; i += 1)
+  {
+    i32 index = WindowsSystemFind(&windows, hidden->normal_mapped_windows.data[i]);
+    if (windows.xs[index] != WorkspaceParkedX(windows.widths[index], windows.borders[index]))
+    {
+      Errorf("Bench: window %d of hidden workspace %u isn't parked", index, hidden->id);
+      ok = false;
+      break;
+    }
+  }
+
+  laid_out = 0;
+  sent     = 0;
+  bytes    = 0;
+  start    = TimeNow();
+  for (u64 i = 0; i < switches; i += 1)
+  {
+    MonitorSwitchWorkspace(allocator, 0, (u16)((i + 1) & 1), &windows);
+    WorkspaceInvalidate(MonitorWorkspace(allocator, 0, MonitorActiveWorkspace(0)));
+    laid_out += BenchLayoutMonitor(allocator, &g_bench_switch_style, &windows);
+    sent += BenchGeometryDiff(&windows, &bytes);
+  }
+  f64 full_ns = (f64)(TimeNow() - start) / (f64)switches;
+  printf("%-24s %10.1f ns, %5.1f windows laid out, %5.1f configures, %6.1f bytes per switch\n",
+         "switch, full relayout", full_ns, (f64)laid_out / (f64)switches,
+         (f64)sent / (f64)switches, (f64)bytes / (f64)switches);
+  return ok;
+}
+
+/*
+Mostly on screen, a sixth of the time anywhere in range or right at its ends
+*/
+internal i16 BenchRandomPosition()
+{
+  u64 kind = BenchRandom() % 6;
+  return kind == 0 ? (i16)BenchRandom()
+       : kind == 1 ? (i16)(INT16_MAX - BenchRandom() % 50)
+       : kind == 2 ? (i16)(INT16_MIN + BenchRandom() % 50)
+                   : (i16)(BenchRandom() % 4000) - 500;
+}
+
+internal u16 BenchRandomSize()
+{
+  u64 kind = BenchRandom() % 6;
+  return kind == 0 ? (u16)BenchRandom()
+       : kind == 1 ? (u16)(UINT16_MAX - BenchRandom() % 50)
+                   : (u16)(1 + BenchRandom() % 2000);
+}
+
+/*
+WindowsSystemNearest against WindowsSystemNearestScalar: 60000 queries over random windows,
+positions and sizes out to the ends of their range, mixed lists, monitors and workspaces and
+every capacity the lanes can end at. Then both timed over 10, 100 and 1000 on screen windows.
+*/
+internal bool BenchNearest(Arena *arena)
+{
+  Allocator allocator = ArenaAllocator(arena);
+  bool      ok        = true;
+  u64       queries   = 0;
+  u64       found     = 0;
+  for (u32 round = 0; ok && round < 3000; round += 1)
+  {
+    Temp          temp    = TempBegin(arena);
+    WindowsSystem windows = WindowsSystemInit(allocator, (u16)(1 + BenchRandom() % 40));
+    u16           count   = (u16)(1 + BenchRandom() % 300);
+    for (u16 i = 0; i < count; i += 1)
+    {
+      WindowsSystemPush(allocator, &windows, 0x400000 + i, BenchRandomPosition(),
+                        BenchRandomPosition(), BenchRandomSize(), BenchRandomSize());
+      windows.borders[i]    = BenchRandom() % 4 ? (u16)(BenchRandom() % 10) : BenchRandomSize();
+      windows.monitors[i]   = (u16)(BenchRandom() % 2);
+      windows.workspaces[i] = (u16)(BenchRandom() % 2);
+      windows.lists[i] =
+          BenchRandom() % 3 ? WindowList_NormalMapped : (WindowList)(BenchRandom() % 7);
+    }
+    for (u32 q = 0; ok && q < 20; q += 1)
+    {
+      u16       from      = (u16)(BenchRandom() % count);
+      Direction direction = (Direction)(BenchRandom() % 4);
+      i32       lanes     = WindowsSystemNearest(&windows, from, direction);
+      i32       scalar    = WindowsSystemNearestScalar(&windows, from, direction);
+      if (lanes != scalar)
+      {
+        Errorf("Bench: nearest %d of window %u in direction %d, the scalar search says %d",
+               lanes, from, direction, scalar);
+        ok = false;
+      }
+      queries += 1;
+      found += lanes != -1;
+    }
+    TempEnd(temp);
+  }
+  printf("%llu random queries agree with the scalar search, %llu found a window\n",
+         (unsigned long long)queries, (unsigned long long)found);
+
+  u32 counts[] = {10, 100, 1000};
+  printf("%8s %12s %12s  (ns)\n", "windows", "lanes", "scalar");
+  for (u32 c = 0; c < sizeof counts / sizeof counts[0]; c += 1)
+  {
+    u32           count      = counts[c];
+    u64           iterations = BENCH_WINDOWS / count;
+    // Starting at the capacity the window manager starts with, the lanes end where its do
+    WindowsSystem windows    = WindowsSystemInit(allocator, 64);
+    for (u32 i = 0; i < count; i += 1)
+    {
+      WindowsSystemPush(allocator, &windows, 0x400000 + i, (i16)(BenchRandom() % 3800),
+                        (i16)(BenchRandom() % 2100), (u16)(50 + BenchRandom() % 400),
+                        (u16)(50 + BenchRandom() % 400));
+      windows.borders[i] = 2;
+      windows.lists[i]   = WindowList_NormalMapped;
+    }
+    // Every window in every direction in turn, the loop counter picks both
+    f64 lanes_ns, scalar_ns;
+    u64 query = 0;
+    BenchNs(lanes_ns, iterations,
+            (query += 1,
+             WindowsSystemNearest(&windows, (u16)(query % count), (Direction)(query & 3))));
+    query = 0;
+    BenchNs(scalar_ns, iterations,
+            (query += 1, WindowsSystemNearestScalar(&windows, (u16)(query % count),
+                                                    (Direction)(query & 3))));
+    printf("%8u %12.1f %12.1f\n", count, lanes_ns, scalar_ns);
+  }
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  Arena *arena = ArenaInit(Gigabytes(1));
+  int    res   = 0;
+  bool   valid = true;
+
+  Bench benches[] = {
+      {"string", BenchString},
+      {"layout", BenchLayout},
+      {"bsp", BenchBsp},
+      {"switch", BenchSwitch},
+      {"nearest", BenchNearest},
+  };
+  u32 benches_count = sizeof benches / sizeof benches[0];
+  for (int i = 1; i < argc; i += 1)
+  {
+    bool known = false;
+    for (u32 b = 0; b < benches_count; b += 1)
+    {
+      known = known || StrEquals(StrCstr(argv[i]), StrCstr((char *)benches[b].name));
+    }
+    if (!known)
+    {
+      Errorf("Unknown benchmark: %s", argv[i]);
+      valid = false;
+      res   = 1;
+    }
+  }
+
+  for (u32 b = 0; valid && b < benches_count; b += 1)
+  {
+    bool selected = argc < 2;
+    for (int i = 1; i < argc; i += 1)
+    {
+      selected = selected || StrEquals(StrCstr(argv[i]), StrCstr((char *)benches[b].name));
+    }
+    if (selected)
+    {
+      printf("== %s\n", benches[b].name);
+      Temp temp = TempBegin(arena);
+      if (!benches[b].func(arena))
+      {
+        res = 1;
+      }
+      TempEnd(temp);
+    }
+  }
+
+  ArenaDeinit(arena);
+  return res;
+}
\ No newline at end of file
@@ -30,7 +30,13 @@ set sources ""
 set link_libraries ""
 if test "$program_name" = "wm"
   set sources "wm/main.c"
-  set link_libraries  "-lX11" "-lX11-xcb" "-lxcb" "-lxcb-cursor" "-lxcb-icccm" "-lxcb-ewmh" "-lxcb-randr"
+  set link_libraries  "-lX11" "-lX11-xcb" "-lxcb" "-lxcb-cursor" "-lxcb-icccm" "-lxcb-ewmh" "-lxcb-randr" "-lxcb-xkb" "-lpthread"
+else if test "$program_name" = "journal"
+  set sources "journal/main.c"
+  set link_libraries "-lm"
+else if test "$program_name" = "bench"
+  set sources "bench/main.c"
+  set link_libraries "-lm" "-lpthread"
 else if test "$program_name" = "testbed_window"
   set sources "testbed_window/main.c"
   set link_libraries  "-lX11" "-lGL" "-lEGL"
@@ -3,6 +3,7 @@
 
 #include "../core_defines.h"
 #include "string.h"
+#include "../log/profile.h"
 
 /*
 Examples:
@@ -84,9 +85,11 @@ Examples:
                                                                                                    \
   internal type_value *funcs_prefix##Find(struct_name *map, type_key key)                          \
   {                                                                                                \
+    ProfileZone(#funcs_prefix "Find");                                                             \
     type_value *res  = {0};                                                                        \
     index_type  hash = hash_func(key, map->capacity);                                              \
-    for (index_type i = hash; i < map->capacity; i += 1)                                           \
+    /* Probe chains never have holes, the first empty slot ends the search */                      \
+    for (index_type i = hash; i < map->capacity && !key_is_empty_func(map->keys[i]); i += 1)       \
     {                                                                                              \
       if (key_equals_func(map->keys[i], key))                                                      \
       {                                                                                            \
@@ -100,22 +103,38 @@ Examples:
   internal bool funcs_prefix##Remove(struct_name *map, type_key key)                               \
   {                                                                                                \
     bool       removed = false;                                                                    \
+    index_type hole    = map->capacity;                                                            \
     index_type hash    = hash_func(key, map->capacity);                                            \
-    for (index_type i = hash; i < map->capacity; i += 1)                                           \
+    for (index_type i = hash; i < map->capacity && !key_is_empty_func(map->keys[i]); i += 1)       \
     {                                                                                              \
       if (key_equals_func(map->keys[i], key))                                                      \
       {                                                                                            \
-        empty_key_value_func(&map->keys[i], &map->values[i]);                                      \
+        hole    = i;                                                                               \
         removed = true;                                                                            \
         break;                                                                                     \
       }                                                                                            \
     }                                                                                              \
+    /* Shift later entries of the chain back so that no hole is left for Find to stop at */        \
+    for (index_type i = hole + 1; i < map->capacity && !key_is_empty_func(map->keys[i]); i += 1)   \
+    {                                                                                              \
+      if (hash_func(map->keys[i], map->capacity) <= hole)                                          \
+      {                                                                                            \
+        map->keys[hole]   = map->keys[i];                                                          \
+        map->values[hole] = map->values[i];                                                        \
+        hole              = i;                                                                     \
+      }                                                                                            \
+    }                                                                                              \
+    if (removed)                                                                                   \
+    {                                                                                              \
+      empty_key_value_func(&map->keys[hole], &map->values[hole]);                                  \
+    }                                                                                              \
     return removed;                                                                                \
   }                                                                                                \
                                                                                                    \
   internal type_value *funcs_prefix##Push(Allocator allocator, struct_name *map, type_key key,     \
                                           type_value value)                                        \
   {                                                                                                \
+    ProfileZone(#funcs_prefix "Push");                                                             \
     Assert(map);                                                                                   \
     type_value *res = funcs_prefix##Find(map, key);                                                \
     if (res)                                                                                       \
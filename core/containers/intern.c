@@ -0,0 +1,140 @@
+#include "intern.h"
+
+internal u32 StrInternHash(String s)
+{
+  u64 hash = 5381;
+  for (u64 i = 0; i < s.size; i += 1)
+  {
+    hash = ((hash << 5) + hash) + s.data[i];
+  }
+  return (u32)(hash ^ (hash >> 32));
+}
+
+internal StrInternTable StrInternTableInit(u64 reserve_size)
+{
+  StrInternTable table   = {0};
+  table.arena            = ArenaInit(reserve_size);
+  table.strings_capacity = 64;
+  table.slots_capacity   = 128;
+  table.strings = (String *)ArenaAlloc(table.arena, sizeof(String) * table.strings_capacity);
+  table.hashes  = (u32 *)ArenaAlloc(table.arena, sizeof(u32) * table.strings_capacity);
+  table.slots   = (StrId *)ArenaAlloc(table.arena, sizeof(StrId) * table.slots_capacity);
+  table.count            = 1;
+  return table;
+}
+
+internal void StrInternTableDeinit(StrInternTable *table)
+{
+  if (table->arena)
+  {
+    ArenaDeinit(table->arena);
+  }
+  *table = (StrInternTable){0};
+}
+
+internal u32 StrInternSlot(StrInternTable *table, String s, u32 hash)
+{
+  u32 mask = table->slots_capacity - 1;
+  u32 slot = hash & mask;
+  for (;;)
+  {
+    StrId id = table->slots[slot];
+    if (id == StrId_None || (table->hashes[id] == hash && StrEquals(table->strings[id], s)))
+    {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+internal bool StrInternGrow(StrInternTable *table)
+{
+  bool ok = true;
+  if (table->count == table->strings_capacity)
+  {
+    u32     new_capacity = table->strings_capacity * 2;
+    String *strings      = (String *)ArenaAlloc(table->arena, sizeof(String) * new_capacity);
+    u32    *hashes       = (u32 *)ArenaAlloc(table->arena, sizeof(u32) * new_capacity);
+    if (!strings || !hashes)
+    {
+      ok = false;
+    }
+    else
+    {
+      memcpy(strings, table->strings, sizeof(String) * table->count);
+      memcpy(hashes, table->hashes, sizeof(u32) * table->count);
+      table->strings          = strings;
+      table->hashes           = hashes;
+      table->strings_capacity = new_capacity;
+    }
+  }
+  // Keep the load factor of the slots under a half
+  if (ok && table->count * 2 >= table->slots_capacity)
+  {
+    u32    new_capacity = table->slots_capacity * 2;
+    StrId *slots        = (StrId *)ArenaAlloc(table->arena, sizeof(StrId) * new_capacity);
+    if (!slots)
+    {
+      ok = false;
+    }
+    else
+    {
+      table->slots          = slots;
+      table->slots_capacity = new_capacity;
+      u32 mask              = new_capacity - 1;
+      for (StrId id = 1; id < table->count; id += 1)
+      {
+        u32 slot = table->hashes[id] & mask;
+        while (slots[slot] != StrId_None)
+        {
+          slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+      }
+    }
+  }
+  return ok;
+}
+
+internal StrId StrIntern(StrInternTable *table, String s)
+{
+  StrId res = StrId_None;
+  if (s.size != 0 && StrInternGrow(table))
+  {
+    u32 hash = StrInternHash(s);
+    u32 slot = StrInternSlot(table, s, hash);
+    res      = table->slots[slot];
+    if (res == StrId_None)
+    {
+      u8 *data = (u8 *)ArenaAlloc(table->arena, s.size);
+      if (data)
+      {
+        memcpy(data, s.data, s.size);
+        res                 = table->count;
+        table->strings[res] = Str(data, s.size);
+        table->hashes[res]  = hash;
+        table->slots[slot]  = res;
+        table->count += 1;
+      }
+    }
+  }
+  return res;
+}
+
+internal StrId StrInternFind(StrInternTable *table, String s)
+{
+  StrId res = StrId_None;
+  if (s.size != 0)
+  {
+    u32 hash = StrInternHash(s);
+    res      = table->slots[StrInternSlot(table, s, hash)];
+  }
+  return res;
+}
+
+internal String StrFromId(StrInternTable *table, StrId id)
+{
+  Assert(id < table->count);
+  return table->strings[id];
+}
\ No newline at end of file
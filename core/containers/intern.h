@@ -0,0 +1,53 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "../core_defines.h"
+#include "../memory/memory.h"
+#include "string.h"
+
+/*
+Stable 32-bit handle of an interned string, two ids are equal iff their strings are equal.
+StrId_None stands for the empty string.
+*/
+typedef u32 StrId;
+#define StrId_None 0
+
+/*
+Maps every distinct string to a StrId. Interned bytes and the lookup tables live in an
+append-only arena owned by the table, so returned Strings stay valid until Deinit.
+Example:
+    StrInternTable table = StrInternTableInit(Megabytes(64));
+    StrId          a     = StrIntern(&table, StrLit("Alacritty"));
+    StrId          b     = StrIntern(&table, StrLit("Alacritty"));
+    Assert(a == b);
+    Assert(StrEquals(StrFromId(&table, a), StrLit("Alacritty")));
+    StrInternTableDeinit(&table);
+*/
+typedef struct
+{
+  Arena  *arena;
+  // Indexed by StrId, strings[StrId_None] is the empty string
+  String *strings;
+  u32    *hashes;
+  u32     count;
+  u32     strings_capacity;
+  // Open addressing table of ids, power of two capacity, StrId_None marks an empty slot
+  StrId  *slots;
+  u32     slots_capacity;
+} StrInternTable;
+
+internal StrInternTable StrInternTableInit(u64 reserve_size);
+internal void           StrInternTableDeinit(StrInternTable *table);
+
+/*
+Returns the id of the string, copying it into the table if it wasn't interned before.
+Returns StrId_None for the empty string or when out of memory.
+*/
+internal StrId  StrIntern(StrInternTable *table, String s);
+/*
+Returns StrId_None if the string was never interned
+*/
+internal StrId  StrInternFind(StrInternTable *table, String s);
+internal String StrFromId(StrInternTable *table, StrId id);
+
+#endif
\ No newline at end of file
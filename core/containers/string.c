@@ -2,6 +2,81 @@
 #include <ctype.h>
 #include <math.h>
 
+// SIMD helpers used by the byte search, substring search and trimming routines below.
+// AVX2 is picked up by release builds (-march=native), SSE2 is the x86-64 baseline;
+// everything else goes through the scalar loops.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define STR_SIMD_WIDTH 32
+typedef __m256i StrSimd;
+
+internal StrSimd StrSimd_Load(const u8 *p)
+{
+  return _mm256_loadu_si256((const __m256i *)p);
+}
+
+internal StrSimd StrSimd_Splat(u8 byte)
+{
+  return _mm256_set1_epi8((char)byte);
+}
+
+internal u32 StrSimd_EqMask(StrSimd a, StrSimd b)
+{
+  return (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+}
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define STR_SIMD_WIDTH 16
+typedef __m128i StrSimd;
+
+internal StrSimd StrSimd_Load(const u8 *p)
+{
+  return _mm_loadu_si128((const __m128i *)p);
+}
+
+internal StrSimd StrSimd_Splat(u8 byte)
+{
+  return _mm_set1_epi8((char)byte);
+}
+
+internal u32 StrSimd_EqMask(StrSimd a, StrSimd b)
+{
+  return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+}
+#endif
+
+#ifdef STR_SIMD_WIDTH
+#define STR_SIMD_FULL_MASK ((u32)(((u64)1 << STR_SIMD_WIDTH) - 1))
+
+/*
+Returns a bitmask of the bytes in the chunk starting at p which are present in the set
+*/
+internal u32 StrSimd_SetMask(const u8 *p, String set)
+{
+  StrSimd chunk = StrSimd_Load(p);
+  u32     mask  = 0;
+  for (u64 j = 0; j < set.size; j += 1)
+  {
+    mask |= StrSimd_EqMask(chunk, StrSimd_Splat(set.data[j]));
+  }
+  return mask;
+}
+#endif
+
+internal bool StrByteInSet(u8 byte, String set)
+{
+  bool res = false;
+  for (u64 j = 0; j < set.size; j += 1)
+  {
+    if (byte == set.data[j])
+    {
+      res = true;
+      break;
+    }
+  }
+  return res;
+}
+
 internal char *CstrFromStr(Allocator allocator, String s)
 {
   char *res = {0};
@@ -48,7 +123,8 @@ internal bool StrEquals(String lhs, String rhs)
   {
     res = false;
   }
-  if (lhs.size != 0 && res)
+  // memcmp is already vectorized by libc, only skip it when there is nothing to compare
+  if (lhs.size != 0 && res && lhs.data != rhs.data)
   {
     int cmp_res = memcmp(lhs.data, rhs.data, lhs.size);
     if (cmp_res != 0)
@@ -87,13 +163,59 @@ internal String StrSubstrTill(String s, u64 end)
 internal u64 StrFindSubStr(String haystack, String needle, u64 min)
 {
   u64 res = haystack.size;
-  for (u64 i = min; i < haystack.size; i += 1)
+  if (needle.size == 0)
+  {
+    res = Min(min, haystack.size);
+  }
+  else if (needle.size == 1)
   {
-    String s = StrSubstr(haystack, i, i + needle.size);
-    if (StrEquals(s, needle))
+    i64 idx = StrIndexByte(StrSubstrFrom(haystack, min), needle.data[0]);
+    if (idx != -1)
     {
-      res = i;
-      break;
+      res = min + (u64)idx;
+    }
+  }
+  else if (min < haystack.size && needle.size <= haystack.size - min)
+  {
+    u64  last_start = haystack.size - needle.size;
+    u64  i          = min;
+    u8   first      = needle.data[0];
+    u8   last       = needle.data[needle.size - 1];
+    bool found      = false;
+#ifdef STR_SIMD_WIDTH
+    // Compare the first and the last needle bytes for a whole chunk of candidate positions,
+    // only candidates matching both are verified with memcmp
+    StrSimd first_splat = StrSimd_Splat(first);
+    StrSimd last_splat  = StrSimd_Splat(last);
+    for (; i + STR_SIMD_WIDTH <= last_start + 1; i += STR_SIMD_WIDTH)
+    {
+      u32 mask = StrSimd_EqMask(StrSimd_Load(haystack.data + i), first_splat) &
+                 StrSimd_EqMask(StrSimd_Load(haystack.data + i + needle.size - 1), last_splat);
+      while (mask != 0)
+      {
+        u64 candidate = i + (u64)__builtin_ctz(mask);
+        if (memcmp(haystack.data + candidate + 1, needle.data + 1, needle.size - 2) == 0)
+        {
+          res   = candidate;
+          found = true;
+          break;
+        }
+        mask &= mask - 1;
+      }
+      if (found)
+      {
+        break;
+      }
+    }
+#endif
+    for (; !found && i <= last_start; i += 1)
+    {
+      if (haystack.data[i] == first && haystack.data[i + needle.size - 1] == last &&
+          memcmp(haystack.data + i + 1, needle.data + 1, needle.size - 2) == 0)
+      {
+        res   = i;
+        found = true;
+      }
     }
   }
   return res;
@@ -101,22 +223,27 @@ internal u64 StrFindSubStr(String haystack, String needle, u64 min)
 
 internal String StrTrimLeft(String s, String trimmed_chars)
 {
-  u64 left = 0;
-  for (u64 i = 0; i < s.size; i += 1)
+  u64  left  = s.size;
+  u64  i     = 0;
+  bool found = false;
+#ifdef STR_SIMD_WIDTH
+  for (; i + STR_SIMD_WIDTH <= s.size; i += STR_SIMD_WIDTH)
   {
-    bool skipped = false;
-    for (u64 j = 0; j < trimmed_chars.size; j += 1)
+    u32 kept = ~StrSimd_SetMask(s.data + i, trimmed_chars) & STR_SIMD_FULL_MASK;
+    if (kept != 0)
     {
-      if (s.data[i] == trimmed_chars.data[j])
-      {
-        skipped = true;
-        break;
-      }
+      left  = i + (u64)__builtin_ctz(kept);
+      found = true;
+      break;
     }
-    if (skipped != true)
+  }
+#endif
+  for (; !found && i < s.size; i += 1)
+  {
+    if (!StrByteInSet(s.data[i], trimmed_chars))
     {
-      left = i;
-      break;
+      left  = i;
+      found = true;
     }
   }
   String res = StrSubstr(s, left, s.size);
@@ -125,25 +252,32 @@ internal String StrTrimLeft(String s, String trimmed_chars)
 
 internal String StrTrimRight(String s, String trimmed_chars)
 {
-  u64 right = s.size;
-  for (i64 i = ((i64)s.size) - 1; i >= 0; i -= 1)
+  // Exclusive end of the kept part of the string
+  u64  right = 0;
+  u64  end   = s.size;
+  bool found = false;
+#ifdef STR_SIMD_WIDTH
+  for (; end >= STR_SIMD_WIDTH; end -= STR_SIMD_WIDTH)
   {
-    bool skipped = false;
-    for (u64 j = 0; j < trimmed_chars.size; j += 1)
+    u64 chunk_start = end - STR_SIMD_WIDTH;
+    u32 kept        = ~StrSimd_SetMask(s.data + chunk_start, trimmed_chars) & STR_SIMD_FULL_MASK;
+    if (kept != 0)
     {
-      if (s.data[i] == trimmed_chars.data[j])
-      {
-        skipped = true;
-        break;
-      }
+      right = chunk_start + (u64)(31 - __builtin_clz(kept)) + 1;
+      found = true;
+      break;
     }
-    if (skipped != true)
+  }
+#endif
+  for (; !found && end > 0; end -= 1)
+  {
+    if (!StrByteInSet(s.data[end - 1], trimmed_chars))
     {
-      right = (u64)i;
-      break;
+      right = end;
+      found = true;
     }
   }
-  String res = StrSubstr(s, 0, right + 1);
+  String res = StrSubstr(s, 0, right);
   return res;
 }
 
@@ -185,14 +319,51 @@ internal String StrJoin(Allocator allocator, String lhs, String sep, String rhs)
 internal i64 StrIndexByte(String s, u8 byte)
 {
   i64 res = -1;
-  for (u64 i = 0; i < s.size; i += 1)
+  u64 i   = 0;
+#ifdef STR_SIMD_WIDTH
+  StrSimd splat = StrSimd_Splat(byte);
+  for (; i + STR_SIMD_WIDTH <= s.size; i += STR_SIMD_WIDTH)
+  {
+    u32 mask = StrSimd_EqMask(StrSimd_Load(s.data + i), splat);
+    if (mask != 0)
+    {
+      res = (i64)(i + (u64)__builtin_ctz(mask));
+      break;
+    }
+  }
+#endif
+  for (; res == -1 && i < s.size; i += 1)
   {
     if (s.data[i] == byte)
     {
       res = (i64)i;
+    }
+  }
+  return res;
+}
+
+internal i64 StrIndexAnyByte(String s, String set)
+{
+  i64 res = -1;
+  u64 i   = 0;
+#ifdef STR_SIMD_WIDTH
+  for (; i + STR_SIMD_WIDTH <= s.size; i += STR_SIMD_WIDTH)
+  {
+    u32 mask = StrSimd_SetMask(s.data + i, set);
+    if (mask != 0)
+    {
+      res = (i64)(i + (u64)__builtin_ctz(mask));
       break;
     }
   }
+#endif
+  for (; res == -1 && i < s.size; i += 1)
+  {
+    if (StrByteInSet(s.data[i], set))
+    {
+      res = (i64)i;
+    }
+  }
   return res;
 }
 
@@ -432,6 +603,35 @@ internal ArrayString StrSplitInitCapacity(Allocator allocator, String s, String
   return res;
 }
 
+internal StrSplitIter StrSplitIterInit(String s, String sep)
+{
+  Assert(sep.size != 0);
+  StrSplitIter it = {0};
+  it.s            = s;
+  it.sep          = sep;
+  return it;
+}
+
+internal bool StrSplitIterNext(StrSplitIter *it, String *piece)
+{
+  bool ok = false;
+  if (!it->done)
+  {
+    u64 pos = StrFindSubStr(it->s, it->sep, it->pos);
+    *piece  = StrSubstr(it->s, it->pos, pos);
+    if (pos == it->s.size)
+    {
+      it->done = true;
+    }
+    else
+    {
+      it->pos = pos + it->sep.size;
+    }
+    ok = true;
+  }
+  return ok;
+}
+
 internal StrBuilder StrBuilder_Init(Allocator allocator, u64 min_capacity)
 {
   StrBuilder builder = {0};
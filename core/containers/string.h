@@ -47,6 +47,10 @@ internal String StrJoin(Allocator allocator, String lhs, String sep, String rhs)
 Returns -1 on failure to find the provided byte
 */
 internal i64 StrIndexByte(String s, u8 byte);
+/*
+Returns the index of the first byte present in the set, -1 if there is none
+*/
+internal i64 StrIndexAnyByte(String s, String set);
 
 internal u64 HashFromString(String key, u64 max);
 
@@ -84,6 +88,27 @@ internal String      ArrayString_Join(Allocator allocator, ArrayString arr, Stri
 internal ArrayString StrSplit(Allocator allocator, String s, String sep);
 internal ArrayString StrSplitInitCapacity(Allocator allocator, String s, String sep,
                                           u64 expected_elements);
+/*
+Lazily yields the pieces between separators without allocating, including the trailing piece
+after the last separator.
+Example:
+    StrSplitIter it = StrSplitIterInit(src, StrLit("\n"));
+    for (String line; StrSplitIterNext(&it, &line);)
+    {
+      Debugf("line: %.*s", StrFmtVal(line));
+    }
+*/
+typedef struct
+{
+  String s;
+  String sep;
+  u64    pos;
+  bool   done;
+} StrSplitIter;
+
+internal StrSplitIter StrSplitIterInit(String s, String sep);
+internal bool         StrSplitIterNext(StrSplitIter *it, String *piece);
+
 // internal ArrayString StrSplitMulti(Allocator allocator, String s, ArrayString substrs);
 // internal ArrayString StrSplitLines(Allocator allocator, String s);
 
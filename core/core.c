@@ -1,8 +1,11 @@
 #include "memory/memory.c"
 #include "os/os.c"
 #include "log/log.c"
+#include "log/trace.c"
+#include "log/profile.c"
 #include "containers/array.c"
 #include "containers/string.c"
 #include "containers/hash_map.c"
+#include "containers/intern.c"
 #include "encoding/ini/ini.c"
 #include "encoding/hex/hex.c"
\ No newline at end of file
@@ -5,9 +5,12 @@
 #include "memory/memory.h"
 #include "os/os.h"
 #include "log/log.h"
+#include "log/trace.h"
+#include "log/profile.h"
 #include "containers/array.h"
 #include "containers/string.h"
 #include "containers/hash_map.h"
+#include "containers/intern.h"
 #include "encoding/ini/ini.h"
 #include "encoding/hex/hex.h"
 
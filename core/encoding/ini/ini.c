@@ -2,82 +2,71 @@
 #include "../../os/os.h"
 #include <ctype.h>
 
+// Whitespace within a line
+#define INI_BLANK " \t\r\v\f"
+
 internal IniValue IniValueFromString(String s)
 {
-  IniValue res = {0};
-  if (s.size == 0)
+  IniValue res          = {0};
+  res.tag               = IniValue_String;
+  res.data.value_String = s;
+  if (StrEquals(s, StrLit("true")))
   {
-    res.tag = IniValue_String;
+    res.tag             = IniValue_bool;
+    res.data.value_bool = true;
   }
-  else
+  else if (StrEquals(s, StrLit("false")))
   {
-    if (StrEquals(s, StrLit("true")))
-    {
-      res.tag             = IniValue_bool;
-      res.data.value_bool = true;
-    }
-    else if (StrEquals(s, StrLit("false")))
-    {
-      res.tag             = IniValue_bool;
-      res.data.value_bool = false;
-    }
-    else
+    res.tag             = IniValue_bool;
+    res.data.value_bool = false;
+  }
+  else if (s.size != 0)
+  {
+    // Digits are accumulated while the value is classified, numbers take no second pass
+    bool negative       = s.data[0] == '-';
+    bool is_number      = s.size > (u64)negative;
+    bool floating_num   = false;
+    u64  whole          = 0;
+    u64  fraction       = 0;
+    f64  fraction_scale = 1;
+    for (u64 i = negative; is_number && i < s.size; i += 1)
     {
-      bool contains_non_digit_chars = false;
-      bool floating_num             = false;
-      bool is_negative_num          = false;
-      for (u64 i = 0; i < s.size; i += 1)
+      u8 c = s.data[i];
+      if (isdigit(c) && floating_num)
       {
-        u8 c = s.data[i];
-        if (!isdigit(c))
-        {
-          if (i == 0 && c == '-')
-          {
-            is_negative_num = -1;
-          }
-          else if (!floating_num && (c == '.' || c == ','))
-          {
-            floating_num = true;
-          }
-          else
-          {
-            contains_non_digit_chars = true;
-            break;
-          }
-        }
+        fraction = fraction * 10 + (c - '0');
+        fraction_scale *= 10;
       }
-
-      if (contains_non_digit_chars)
+      else if (isdigit(c))
       {
-        res.tag               = IniValue_String;
-        res.data.value_String = s;
+        whole = whole * 10 + (c - '0');
+      }
+      else if (!floating_num && (c == '.' || c == ','))
+      {
+        floating_num = true;
       }
       else
       {
-        if (floating_num)
-        {
-          f64 num = 0;
-          F64FromStr(s, &num);
-          res.tag            = IniValue_f64;
-          res.data.value_f64 = num;
-        }
-        else
-        {
-          u64 num = 0;
-          U64FromStr(s, &num);
-          if (is_negative_num)
-          {
-            res.tag            = IniValue_i64;
-            res.data.value_i64 = (i64)num * -1;
-          }
-          else
-          {
-            res.tag            = IniValue_u64;
-            res.data.value_u64 = num;
-          }
-        }
+        is_number = false;
       }
     }
+
+    if (is_number && floating_num)
+    {
+      f64 num            = (f64)whole + (f64)fraction / fraction_scale;
+      res.tag            = IniValue_f64;
+      res.data.value_f64 = negative ? -num : num;
+    }
+    else if (is_number && negative)
+    {
+      res.tag            = IniValue_i64;
+      res.data.value_i64 = (i64)whole * -1;
+    }
+    else if (is_number)
+    {
+      res.tag            = IniValue_u64;
+      res.data.value_u64 = whole;
+    }
   }
   return res;
 }
@@ -93,79 +82,112 @@ internal IniMap Ini_LoadMapFromPath(Allocator allocator, String path)
   return Ini_LoadMapFromString(allocator, src);
 }
 
+/*
+Returns the cursor past the newline ending the line the cursor is on
+*/
+internal u64 Ini_SkipLine(String src, u64 cursor)
+{
+  i64 newline = StrIndexByte(StrSubstrFrom(src, cursor), '\n');
+  return newline == -1 ? src.size : cursor + (u64)newline + 1;
+}
+
+/*
+Single pass over the source, lines are never materialized. The cursor only moves forward,
+every line is searched for its delimiters once and keys and values are slices into src.
+*/
 internal IniMap Ini_LoadMapFromString(Allocator allocator, String src)
 {
-  IniMap      res          = IniMap_Init(allocator, 50);
-  String      section_name = {0};
-  IniSection  section      = {0};
-  ArrayString lines        = StrSplit(allocator, src, StrLit("\n"));
-  for (u64 i = 0; i < lines.size; i += 1)
+  ProfileZone("Ini_LoadMapFromString");
+  IniMap     res          = IniMap_Init(allocator, 16);
+  String     section_name = {0};
+  IniSection section      = {0};
+  String     blank        = StrLit(INI_BLANK " \n");
+  u64        cursor       = 0;
+  while (cursor < src.size)
   {
-    String line = StrTrimSpaces(lines.data[i]);
-
-    i64 comment_start_idx = StrIndexByte(line, ';');
-    if (comment_start_idx != -1)
-    {
-      line = StrSubstrTill(line, comment_start_idx);
-      if (line.size == 0)
-      {
-        continue;
-      }
-    }
+    // Leading blanks and empty lines are skipped in one go
+    String line = StrTrimLeft(StrSubstrFrom(src, cursor), blank);
+    cursor      = src.size - line.size;
     if (line.size == 0)
     {
-      continue;
+      break;
     }
 
+    // Content ends at a newline or a comment, end is relative to the line start
+    u64  end    = line.size;
+    bool header = false;
     if (line.data[0] == '[')
     {
-      i64 end_idx = StrIndexByte(line, ']');
-      if (end_idx != -1)
+      i64 close = StrIndexAnyByte(line, StrLit("]\n;"));
+      if (close != -1 && line.data[close] == ']')
       {
+        header = true;
+        end    = (u64)close;
         if (section_name.size != 0)
         {
           IniMap_Push(allocator, &res, section_name, section);
         }
-        if (line.size > 2 && line.data[1] == '[')
+        if (close > 1 && line.data[1] == '[')
         {
-          section_name       = StrSubstr(line, 2, end_idx);
+          section_name       = StrSubstr(line, 2, close);
           section.tag        = IniSection_Array;
-          section.data.array = ArrayString_Init(allocator, 20);
+          section.data.array = ArrayString_Init(allocator, 64);
         }
         else
         {
-          section_name     = StrSubstr(line, 1, end_idx);
+          section_name     = StrSubstr(line, 1, close);
           section.tag      = IniSection_Map;
-          section.data.map = IniValueMap_Init(allocator, 50);
+          section.data.map = IniValueMap_Init(allocator, 64);
         }
-        continue;
       }
     }
 
+    if (header || line.data[0] == ';')
+    {
+      cursor = Ini_SkipLine(src, cursor);
+      continue;
+    }
+
     if (section.tag == IniSection_Array)
     {
-      ArrayString_Push(allocator, &section.data.array, line);
+      i64 stop = StrIndexAnyByte(line, StrLit("\n;"));
+      end      = stop == -1 ? line.size : (u64)stop;
+      if (section_name.size != 0)
+      {
+        String item = StrTrimRight(StrSubstrTill(line, end), StrLit(INI_BLANK));
+        ArrayString_Push(allocator, &section.data.array, item);
+      }
     }
     else
     {
-      i64 equal_sign = StrIndexByte(line, '=');
-      if (equal_sign != -1)
+      i64 stop = StrIndexAnyByte(line, StrLit("=\n;"));
+      end      = stop == -1 ? line.size : (u64)stop;
+      if (stop != -1 && line.data[stop] == '=')
       {
-        String key       = Unquote(StrTrimSpaces(StrSubstrTill(line, equal_sign)));
-        String value_str = Unquote(StrTrimSpaces(StrSubstrFrom(line, equal_sign + 1)));
-        if (key.size != 0)
+        String rest       = StrSubstrFrom(line, end + 1);
+        i64    value_stop = StrIndexAnyByte(rest, StrLit("\n;"));
+        u64    value_end  = value_stop == -1 ? rest.size : (u64)value_stop;
+        String key        = Unquote(StrTrimRight(StrSubstrTill(line, end), StrLit(INI_BLANK)));
+        String value_str  = Unquote(StrTrim(StrSubstrTill(rest, value_end), StrLit(INI_BLANK)));
+        end += 1 + value_end;
+        if (key.size != 0 && section_name.size != 0)
         {
           IniValue value = IniValueFromString(value_str);
           IniValueMap_Push(allocator, &section.data.map, key, value);
         }
       }
     }
+
+    cursor += end;
+    if (cursor < src.size)
+    {
+      cursor = src.data[cursor] == '\n' ? cursor + 1 : Ini_SkipLine(src, cursor);
+    }
   }
   if (section_name.size != 0)
   {
     IniMap_Push(allocator, &res, section_name, section);
   }
-  ArrayString_Deinit(allocator, &lines);
 
   return res;
 }
@@ -173,4 +195,4 @@ internal IniMap Ini_LoadMapFromString(Allocator allocator, String src)
 internal void Ini_DeinitMap(Allocator allocator, IniMap *map)
 {
   IniMap_Deinit(allocator, map);
-}
+}
\ No newline at end of file
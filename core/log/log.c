@@ -1,39 +1,268 @@
 #include "log.h"
+#include "../os/os_time.h"
 #include <time.h>
 #include <stdarg.h>
+#include <pthread.h>
 
-internal void Logf(const char *prefix, const char *file, int line, const char *format, ...)
+#define LOG_MAX_THREADS 8
+// Must be a power of two
+#define LOG_RING_CAPACITY 512
+#define LOG_PAYLOAD_SIZE 232
+#define LOG_BATCH_SIZE Kilobytes(64)
+
+// Compact record, the prefix and file point at string literals so only the payload is copied
+typedef struct
 {
-  time_t now;
-  time(&now);
-  struct tm *tm_info = localtime(&now);
+  const char *prefix;
+  const char *file;
+  u64         timestamp;
+  u32         line;
+  u16         payload_size;
+  char        payload[LOG_PAYLOAD_SIZE];
+} LogRecord;
 
-  char timestamp[70];
-  strftime(timestamp, sizeof timestamp, "[%Y-%m-%d %H:%M:%S]", tm_info);
+// Single producer (the owning thread), single consumer (the writer thread). A ring is owned
+// while claimed is set and goes back to the pool when its thread exits.
+typedef struct
+{
+  u64       head;
+  u64       tail;
+  u64       dropped;
+  u32       claimed;
+  LogRecord records[LOG_RING_CAPACITY];
+} LogRing;
 
-  printf("%s %s (%s:%d): ", prefix, timestamp, file, line);
+typedef struct
+{
+  LogRing       rings[LOG_MAX_THREADS];
+  // Its destructor hands a ring back once the owning thread exits
+  pthread_key_t ring_key;
+  bool          ring_key_created;
+  u64           dropped_no_ring;
+  bool          running;
+  pthread_t     writer;
+  char          batch[LOG_BATCH_SIZE];
+  u64           batch_size;
+  // Cached "[%Y-%m-%d %H:%M:%S" of the last formatted second
+  i64           cached_second;
+  char          cached_timestamp[32];
+} LogState;
 
-  // Initialize the va_list for variadic arguments
-  va_list args;
-  va_start(args, format);
+LogState                     g_log;
+static _Thread_local LogRing *t_log_ring;
 
-  // Forward the format and variadic arguments to printf
-  vprintf(format, args);
+internal u64 LogFormatLine(char *dest, u64 dest_size, const char *prefix, const char *file,
+                           int line, u64 timestamp, const char *payload, u64 payload_size)
+{
+  i64 second = (i64)(timestamp / Seconds(1));
+  if (second != g_log.cached_second || g_log.cached_timestamp[0] == '\0')
+  {
+    time_t    t = (time_t)second;
+    struct tm tm_info;
+    localtime_r(&t, &tm_info);
+    strftime(g_log.cached_timestamp, sizeof g_log.cached_timestamp, "[%Y-%m-%d %H:%M:%S",
+             &tm_info);
+    g_log.cached_second = second;
+  }
+  u64 millis = (timestamp % Seconds(1)) / Milliseconds(1);
+  int size   = snprintf(dest, dest_size, "%s %s.%03llu] (%s:%d): %.*s\n", prefix,
+                        g_log.cached_timestamp, (unsigned long long)millis, file, line,
+                        (int)payload_size, payload);
+  return size < 0 ? 0 : Min((u64)size, dest_size - 1);
+}
 
-  // Clean up the va_list
-  va_end(args);
+internal void LogBatchFlush()
+{
+  if (g_log.batch_size)
+  {
+    fwrite(g_log.batch, 1, g_log.batch_size, stdout);
+    fflush(stdout);
+    g_log.batch_size = 0;
+  }
+}
+
+internal void LogBatchPush(const char *prefix, const char *file, int line, u64 timestamp,
+                           const char *payload, u64 payload_size)
+{
+  // Longest prefix, timestamp and location that fit a record, leaves room for the payload
+  u64 max_line_size = LOG_PAYLOAD_SIZE + 512;
+  if (g_log.batch_size + max_line_size > sizeof g_log.batch)
+  {
+    LogBatchFlush();
+  }
+  g_log.batch_size +=
+      LogFormatLine(g_log.batch + g_log.batch_size, sizeof g_log.batch - g_log.batch_size, prefix,
+                    file, line, timestamp, payload, payload_size);
+}
+
+/*
+Returns true if at least one record or drop report was written
+*/
+internal bool LogDrain()
+{
+  bool drained = false;
+  // Released rings are drained too, records their thread pushed before exiting still go out
+  for (u32 i = 0; i < LOG_MAX_THREADS; i += 1)
+  {
+    LogRing *ring = &g_log.rings[i];
+    u64      head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    for (u64 tail = ring->tail; tail != head; tail += 1)
+    {
+      LogRecord *record = &ring->records[tail & (LOG_RING_CAPACITY - 1)];
+      LogBatchPush(record->prefix, record->file, (int)record->line, record->timestamp,
+                   record->payload, record->payload_size);
+      drained = true;
+    }
+    __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+
+    u64 dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+    if (dropped)
+    {
+      char msg[64];
+      int  size = snprintf(msg, sizeof msg, "log ring %u overflowed, dropped %llu records", i,
+                           (unsigned long long)dropped);
+      LogBatchPush("\033[33m[WARN]\033[0m", __FILE__, __LINE__, TimeNow(), msg, (u64)size);
+      drained = true;
+    }
+  }
+  u64 dropped = __atomic_exchange_n(&g_log.dropped_no_ring, 0, __ATOMIC_RELAXED);
+  if (dropped)
+  {
+    char msg[64];
+    int  size = snprintf(msg, sizeof msg, "all log rings in use, dropped %llu records",
+                         (unsigned long long)dropped);
+    LogBatchPush("\033[33m[WARN]\033[0m", __FILE__, __LINE__, TimeNow(), msg, (u64)size);
+    drained = true;
+  }
+  LogBatchFlush();
+  return drained;
+}
 
-  printf("\n");
+internal void *LogWriterThread(void *arg)
+{
+  (void)arg;
+  while (__atomic_load_n(&g_log.running, __ATOMIC_ACQUIRE))
+  {
+    if (!LogDrain())
+    {
+      Sleep(Milliseconds(2));
+    }
+  }
+  return NULL;
+}
+
+/*
+Runs as the owning thread exits, anything it pushed stays in the ring until the writer drains it
+*/
+internal void LogReleaseRing(void *ring)
+{
+  t_log_ring = NULL;
+  __atomic_store_n(&((LogRing *)ring)->claimed, 0, __ATOMIC_RELEASE);
+}
+
+internal bool LogInit()
+{
+  bool ok = true;
+  if (!g_log.ring_key_created)
+  {
+    g_log.ring_key_created = pthread_key_create(&g_log.ring_key, LogReleaseRing) == 0;
+  }
+  if (!g_log.running)
+  {
+    __atomic_store_n(&g_log.running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&g_log.writer, NULL, LogWriterThread, NULL) != 0)
+    {
+      __atomic_store_n(&g_log.running, false, __ATOMIC_RELEASE);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+internal void LogDeinit()
+{
+  if (g_log.running)
+  {
+    __atomic_store_n(&g_log.running, false, __ATOMIC_RELEASE);
+    pthread_join(g_log.writer, NULL);
+    LogDrain();
+  }
 }
 
-internal void Log(const char *prefix, const char *file, int line, const char* msg)
+/*
+Returns NULL if every ring is owned by a live thread. Without the release key a claimed ring
+could never be handed back, so no ring is claimed at all and records are counted as dropped.
+*/
+internal LogRing *LogThreadRing()
 {
-  time_t now;
-  time(&now);
-  struct tm *tm_info = localtime(&now);
+  for (u32 i = 0; !t_log_ring && g_log.ring_key_created && i < LOG_MAX_THREADS; i += 1)
+  {
+    LogRing *ring = &g_log.rings[i];
+    u32      free = 0;
+    if (!__atomic_load_n(&ring->claimed, __ATOMIC_RELAXED) &&
+        __atomic_compare_exchange_n(&ring->claimed, &free, 1, false, __ATOMIC_ACQUIRE,
+                                    __ATOMIC_RELAXED))
+    {
+      if (pthread_setspecific(g_log.ring_key, ring) == 0)
+      {
+        t_log_ring = ring;
+      }
+      else
+      {
+        __atomic_store_n(&ring->claimed, 0, __ATOMIC_RELEASE);
+      }
+    }
+  }
+  return t_log_ring;
+}
 
-  char timestamp[70];
-  strftime(timestamp, sizeof timestamp, "[%Y-%m-%d %H:%M:%S]", tm_info);
+internal void Logf(const char *prefix, const char *file, int line, const char *format, ...)
+{
+  u64     timestamp = TimeNow();
+  va_list args;
+  va_start(args, format);
+  if (!__atomic_load_n(&g_log.running, __ATOMIC_ACQUIRE))
+  {
+    char payload[LOG_PAYLOAD_SIZE * 4];
+    int  size = vsnprintf(payload, sizeof payload, format, args);
+    char text[sizeof payload + 512];
+    u64  text_size = LogFormatLine(text, sizeof text, prefix, file, line, timestamp, payload,
+                                   Min((u64)Max(size, 0), sizeof payload - 1));
+    fwrite(text, 1, text_size, stdout);
+  }
+  else
+  {
+    LogRing *ring = LogThreadRing();
+    if (!ring)
+    {
+      __atomic_fetch_add(&g_log.dropped_no_ring, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+      u64 head = ring->head;
+      u64 tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+      if (head - tail == LOG_RING_CAPACITY)
+      {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+      }
+      else
+      {
+        // The payload is formatted straight into the ring slot, the writer does the rest
+        LogRecord *record    = &ring->records[head & (LOG_RING_CAPACITY - 1)];
+        int        size      = vsnprintf(record->payload, sizeof record->payload, format, args);
+        record->prefix       = prefix;
+        record->file         = file;
+        record->line         = (u32)line;
+        record->timestamp    = timestamp;
+        record->payload_size = (u16)Min((u64)Max(size, 0), sizeof record->payload - 1);
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+      }
+    }
+  }
+  va_end(args);
+}
 
-  printf("%s %s (%s:%d): %s\n", prefix, timestamp, file, line, msg);
+internal void Log(const char *prefix, const char *file, int line, const char *msg)
+{
+  Logf(prefix, file, line, "%s", msg);
 }
\ No newline at end of file
@@ -3,6 +3,16 @@
 
 #include "../core_defines.h"
 
+/*
+Starts the background writer thread. Until it is started (and after LogDeinit) records are
+formatted and written synchronously on the calling thread.
+*/
+internal bool LogInit();
+/*
+Drains every pending record, reports dropped ones and joins the writer thread
+*/
+internal void LogDeinit();
+
 internal void Logf(const char *prefix, const char *file, int line, const char *format, ...);
 internal void Log(const char *prefix, const char *file, int line, const char *msg);
 
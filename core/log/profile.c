@@ -0,0 +1,200 @@
+#include "profile.h"
+#include "log.h"
+#include "../os/os_time.h"
+#include <signal.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+internal u64 ReadTsc()
+{
+  return __rdtsc();
+}
+#else
+internal u64 ReadTsc()
+{
+  return TimeNow();
+}
+#endif
+
+typedef struct
+{
+  const char *name;
+  u64         inclusive;
+  u64         exclusive;
+  u64         hits;
+} ProfileZoneStats;
+
+// Written by its thread only, the counters are stored atomically so the report can read them
+struct ProfileThread
+{
+  u32              current;
+  // Slot 0 stands for "no enclosing zone"
+  ProfileZoneStats zones[PROFILE_MAX_ZONES];
+};
+
+typedef struct
+{
+  bool          enabled;
+  u64           tsc_frequency;
+  u64           start_tsc;
+  ProfileThread threads[PROFILE_MAX_THREADS];
+  u32           threads_count;
+} Profiler;
+
+Profiler                            g_profiler;
+static _Thread_local ProfileThread *t_profile_thread;
+static volatile sig_atomic_t        g_profiler_report_requested;
+
+internal void ProfilerSignalHandler(int signal)
+{
+  (void)signal;
+  g_profiler_report_requested = 1;
+}
+
+internal void ProfilerInit(bool enabled)
+{
+  g_profiler.enabled = enabled;
+  if (enabled)
+  {
+    u64 time_start = TimeNow();
+    u64 tsc_start  = ReadTsc();
+    Sleep(Milliseconds(10));
+    u64 elapsed_time         = TimeNow() - time_start;
+    u64 elapsed_tsc          = ReadTsc() - tsc_start;
+    g_profiler.tsc_frequency = elapsed_tsc * Seconds(1) / Max(elapsed_time, 1);
+    g_profiler.start_tsc     = ReadTsc();
+
+    struct sigaction action = {0};
+    action.sa_handler       = ProfilerSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+    Infof("Profiler: enabled, timestamp counter at %llu Hz, send SIGUSR1 for a report",
+          (unsigned long long)g_profiler.tsc_frequency);
+  }
+}
+
+/*
+Returns NULL once every table is taken
+*/
+internal ProfileThread *ProfileThreadTable()
+{
+  if (!t_profile_thread &&
+      __atomic_load_n(&g_profiler.threads_count, __ATOMIC_RELAXED) < PROFILE_MAX_THREADS)
+  {
+    u32 index = __atomic_fetch_add(&g_profiler.threads_count, 1, __ATOMIC_ACQ_REL);
+    if (index < PROFILE_MAX_THREADS)
+    {
+      t_profile_thread = &g_profiler.threads[index];
+    }
+  }
+  return t_profile_thread;
+}
+
+internal ProfileBlock ProfileBlockBegin(const char *name, u32 index)
+{
+  ProfileBlock block = {0};
+  if (g_profiler.enabled)
+  {
+    ProfileThread *thread = ProfileThreadTable();
+    if (thread)
+    {
+      ProfileZoneStats *zone = &thread->zones[index];
+      __atomic_store_n(&zone->name, name, __ATOMIC_RELAXED);
+      block.thread        = thread;
+      block.index         = index;
+      block.parent        = thread->current;
+      block.old_inclusive = zone->inclusive;
+      thread->current     = index;
+      block.start         = ReadTsc();
+    }
+  }
+  return block;
+}
+
+internal void ProfileBlockEnd(ProfileBlock *block)
+{
+  if (block->index != 0)
+  {
+    u64               elapsed = ReadTsc() - block->start;
+    ProfileThread    *thread  = block->thread;
+    ProfileZoneStats *zone    = &thread->zones[block->index];
+    ProfileZoneStats *parent  = &thread->zones[block->parent];
+    __atomic_store_n(&parent->exclusive, parent->exclusive - elapsed, __ATOMIC_RELAXED);
+    __atomic_store_n(&zone->exclusive, zone->exclusive + elapsed, __ATOMIC_RELAXED);
+    // Recursive zones only count the outermost call into the inclusive time
+    __atomic_store_n(&zone->inclusive, block->old_inclusive + elapsed, __ATOMIC_RELAXED);
+    __atomic_store_n(&zone->hits, zone->hits + 1, __ATOMIC_RELAXED);
+    thread->current = block->parent;
+  }
+}
+
+internal void ProfilerReport()
+{
+  if (g_profiler.enabled)
+  {
+    u64 total   = ReadTsc() - g_profiler.start_tsc;
+    u32 threads = Min(__atomic_load_n(&g_profiler.threads_count, __ATOMIC_ACQUIRE),
+                      PROFILE_MAX_THREADS);
+    // Every thread's table has the same slots, each call site has one
+    ProfileZoneStats zones[PROFILE_MAX_ZONES] = {0};
+    for (u32 t = 0; t < threads; t += 1)
+    {
+      for (u32 i = 1; i < PROFILE_MAX_ZONES; i += 1)
+      {
+        ProfileZoneStats *zone = &g_profiler.threads[t].zones[i];
+        u64               hits = __atomic_load_n(&zone->hits, __ATOMIC_RELAXED);
+        if (hits != 0)
+        {
+          zones[i].name = __atomic_load_n(&zone->name, __ATOMIC_RELAXED);
+          zones[i].hits += hits;
+          zones[i].inclusive += __atomic_load_n(&zone->inclusive, __ATOMIC_RELAXED);
+          // Nested zones are taken out of a zone that is still open as they end, it's
+          // negative until it ends too
+          i64 exclusive = (i64)__atomic_load_n(&zone->exclusive, __ATOMIC_RELAXED);
+          zones[i].exclusive += (u64)Max(exclusive, 0);
+        }
+      }
+    }
+    u32 order[PROFILE_MAX_ZONES];
+    u32 count = 0;
+    for (u32 i = 1; i < PROFILE_MAX_ZONES; i += 1)
+    {
+      if (zones[i].hits != 0)
+      {
+        order[count] = i;
+        count += 1;
+      }
+    }
+    // Insertion sort by exclusive time, the table is tiny
+    for (u32 i = 1; i < count; i += 1)
+    {
+      for (u32 j = i; j > 0 && zones[order[j]].exclusive > zones[order[j - 1]].exclusive;
+           j -= 1)
+      {
+        SwapT(order[j], order[j - 1], u32);
+      }
+    }
+
+    f64 ms_per_tick = 1000.0 / (f64)Max(g_profiler.tsc_frequency, 1);
+    Infof("Profiler: %.3f ms since start, %u zones over %u threads", (f64)total * ms_per_tick,
+          count, threads);
+    Infof("%-32s %12s %14s %14s %8s", "zone", "hits", "inclusive ms", "exclusive ms", "excl %");
+    for (u32 i = 0; i < count; i += 1)
+    {
+      ProfileZoneStats *zone = &zones[order[i]];
+      Infof("%-32s %12llu %14.3f %14.3f %7.2f%%", zone->name, (unsigned long long)zone->hits,
+            (f64)zone->inclusive * ms_per_tick, (f64)zone->exclusive * ms_per_tick,
+            100.0 * (f64)zone->exclusive / (f64)Max(total, 1));
+    }
+  }
+}
+
+internal void ProfilerPollReport()
+{
+  if (g_profiler_report_requested)
+  {
+    g_profiler_report_requested = 0;
+    ProfilerReport();
+  }
+}
\ No newline at end of file
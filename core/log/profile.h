@@ -0,0 +1,63 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "../core_defines.h"
+
+#define PROFILE_MAX_ZONES 256
+#define PROFILE_MAX_THREADS 8
+
+#define _ProfileConcat2(a, b) a##b
+#define _ProfileConcat(a, b) _ProfileConcat2(a, b)
+
+/*
+Times the rest of the enclosing scope against the zone name, zones nest and both inclusive
+and exclusive (minus nested zones) cycles are accumulated. Every call site gets its own slot
+in a fixed table, the name must be a string literal. Every thread records into a table of its
+own, claimed on its first zone and kept after it exits, the report adds them up. Zones hit
+on threads past the first PROFILE_MAX_THREADS are skipped. Disabled, a zone is a load and a
+branch, the thread's table isn't looked up.
+Example:
+    internal void HandleSomething()
+    {
+      ProfileZone("HandleSomething");
+      ...
+    }
+*/
+#define ProfileZone(name) _ProfileZone(name, __COUNTER__ + 1)
+// The index is expanded once, so the check and the slot see the same one. Slot 0 is the root.
+#define _ProfileZone(name, index)                                                                  \
+  _Static_assert((index) < PROFILE_MAX_ZONES, "More ProfileZone call sites than zone slots, "     \
+                                              "raise PROFILE_MAX_ZONES");                          \
+  ProfileBlock _ProfileConcat(_profile_block_, __LINE__)                                           \
+      __attribute__((cleanup(ProfileBlockEnd))) = ProfileBlockBegin(name, index)
+
+typedef struct ProfileThread ProfileThread;
+
+typedef struct
+{
+  ProfileThread *thread;
+  u64            start;
+  u64            old_inclusive;
+  u32            index;
+  u32            parent;
+} ProfileBlock;
+
+/*
+Calibrates the timestamp counter against TimeNow() and installs a SIGUSR1 handler which
+requests a report. With enabled set to false every zone costs a single branch.
+*/
+internal void ProfilerInit(bool enabled);
+/*
+Prints the report if one was requested by SIGUSR1 since the last call
+*/
+internal void ProfilerPollReport();
+/*
+Prints zones sorted by exclusive time, summed over every thread. Other threads may still be
+inside a zone, their open zones count once they end.
+*/
+internal void ProfilerReport();
+
+internal ProfileBlock ProfileBlockBegin(const char *name, u32 index);
+internal void         ProfileBlockEnd(ProfileBlock *block);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "trace.h"
+#include "../memory/memory.h"
+#include "../os/os_time.h"
+
+// A thread stops recording once it recorded this many events, the rest is counted as dropped
+#define TRACE_MAX_EVENTS Million(4)
+// Threads past this many record nothing, their events are counted as dropped
+#define TRACE_MAX_THREADS 8
+
+typedef struct
+{
+  const char *name;
+  u64         timestamp;
+  u64         id;
+  char        phase;
+} TraceEvent;
+
+// Only the owning thread writes to it, TraceDeinit reads it once every thread was joined
+typedef struct
+{
+  Arena      *arena;
+  TraceEvent *events;
+  u64         count;
+  u64         dropped;
+} TraceBuffer;
+
+typedef struct
+{
+  bool        enabled;
+  char       *path;
+  TraceBuffer buffers[TRACE_MAX_THREADS];
+  u32         buffers_count;
+  u64         dropped_no_buffer;
+} TraceState;
+
+TraceState                       g_trace;
+static _Thread_local TraceBuffer *t_trace_buffer;
+
+/*
+Claims a buffer for the calling thread on its first event, NULL if every one is taken. The
+thread that called TraceInit gets the first one, its events show up as tid 1.
+*/
+internal TraceBuffer *TraceThreadBuffer()
+{
+  if (!t_trace_buffer &&
+      __atomic_load_n(&g_trace.buffers_count, __ATOMIC_ACQUIRE) < TRACE_MAX_THREADS)
+  {
+    u32 index = __atomic_fetch_add(&g_trace.buffers_count, 1, __ATOMIC_ACQ_REL);
+    if (index < TRACE_MAX_THREADS)
+    {
+      // Only address space is reserved up front, pages are committed as events come in
+      TraceBuffer *buffer = &g_trace.buffers[index];
+      buffer->arena       = ArenaInit(sizeof(TraceEvent) * TRACE_MAX_EVENTS + Megabytes(1));
+      t_trace_buffer      = buffer;
+    }
+  }
+  return t_trace_buffer;
+}
+
+internal bool TraceInit(char *path)
+{
+  g_trace.path              = path;
+  g_trace.buffers_count     = 0;
+  g_trace.dropped_no_buffer = 0;
+  g_trace.enabled           = true;
+  TraceBuffer *buffer       = TraceThreadBuffer();
+  g_trace.enabled           = buffer && buffer->arena;
+  return g_trace.enabled;
+}
+
+internal void TracePush(const char *name, char phase, u64 id)
+{
+  if (g_trace.enabled)
+  {
+    TraceBuffer *buffer = TraceThreadBuffer();
+    if (!buffer)
+    {
+      __atomic_fetch_add(&g_trace.dropped_no_buffer, 1, __ATOMIC_RELAXED);
+    }
+    else if (buffer->arena && buffer->count < TRACE_MAX_EVENTS)
+    {
+      // Events are 32 bytes, a multiple of the arena alignment, so they stay contiguous
+      TraceEvent *event = (TraceEvent *)ArenaAlloc(buffer->arena, sizeof(TraceEvent));
+      if (buffer->count == 0)
+      {
+        buffer->events = event;
+      }
+      event->name      = name;
+      event->timestamp = TimeNow();
+      event->id        = id;
+      event->phase     = phase;
+      buffer->count += 1;
+    }
+    else
+    {
+      buffer->dropped += 1;
+    }
+  }
+}
+
+internal void TraceBegin(const char *name)
+{
+  TracePush(name, 'B', 0);
+}
+
+internal void TraceEnd()
+{
+  TracePush(NULL, 'E', 0);
+}
+
+internal void TraceFlowStart(const char *name, u64 id)
+{
+  TracePush(name, 's', id);
+}
+
+internal void TraceFlowEnd(const char *name, u64 id)
+{
+  TracePush(name, 'f', id);
+}
+
+internal void TraceDeinit()
+{
+  if (g_trace.enabled)
+  {
+    g_trace.enabled     = false;
+    FILE *file          = fopen(g_trace.path, "w");
+    u32   buffers_count = Min(g_trace.buffers_count, TRACE_MAX_THREADS);
+    u64   count         = 0;
+    u64   dropped       = g_trace.dropped_no_buffer;
+    u64   origin        = UINT64_MAX;
+    for (u32 t = 0; t < buffers_count; t += 1)
+    {
+      TraceBuffer *buffer = &g_trace.buffers[t];
+      count += buffer->count;
+      dropped += buffer->dropped;
+      if (buffer->count != 0)
+      {
+        origin = Min(origin, buffer->events[0].timestamp);
+      }
+    }
+    if (file == NULL)
+    {
+      Errorf("Trace: failed to open %s", g_trace.path);
+    }
+    else
+    {
+      // Events of each thread are written in order, viewers sort by timestamp per tid
+      bool first = true;
+      fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+      for (u32 t = 0; t < buffers_count; t += 1)
+      {
+        TraceBuffer *buffer = &g_trace.buffers[t];
+        for (u64 i = 0; i < buffer->count; i += 1)
+        {
+          TraceEvent *event = &buffer->events[i];
+          f64         ts    = (f64)(event->timestamp - origin) / (f64)Microsecons(1);
+          fprintf(file, "%s{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+                  first ? "" : ",\n", event->phase, ts, t + 1);
+          if (event->name)
+          {
+            fprintf(file, ",\"name\":\"%s\"", event->name);
+          }
+          if (event->phase == 's' || event->phase == 'f')
+          {
+            fprintf(file, ",\"cat\":\"xcb\",\"id\":%llu", (unsigned long long)event->id);
+          }
+          if (event->phase == 'f')
+          {
+            fprintf(file, ",\"bp\":\"e\"");
+          }
+          fprintf(file, "}");
+          first = false;
+        }
+      }
+      fprintf(file, "\n]}\n");
+      fclose(file);
+      Infof("Trace: wrote %llu events from %u threads to %s, dropped %llu",
+            (unsigned long long)count, buffers_count, g_trace.path, (unsigned long long)dropped);
+    }
+    for (u32 t = 0; t < buffers_count; t += 1)
+    {
+      if (g_trace.buffers[t].arena)
+      {
+        ArenaDeinit(g_trace.buffers[t].arena);
+      }
+      g_trace.buffers[t] = (TraceBuffer){0};
+    }
+    g_trace.buffers_count = 0;
+  }
+}
\ No newline at end of file
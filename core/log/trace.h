@@ -0,0 +1,42 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "../core_defines.h"
+
+/*
+Chrome trace-event recorder, load the written file in Perfetto or chrome://tracing.
+Names must outlive the recorder (string literals or static tables), nothing is copied.
+Recording is off until TraceInit succeeds, every call is a single branch then. Any thread may
+record, each one into its own buffer and under its own tid. TraceDeinit runs after the other
+recording threads were joined.
+Example:
+    TraceInit("/tmp/wm.trace.json");
+    TraceBegin("frame");
+    {
+      xcb_get_property_cookie_t cookie = xcb_get_property(...);
+      TraceFlowStart("GetProperty", cookie.sequence);
+      ...
+      TraceBegin("xcb_get_property_reply");
+      reply = xcb_get_property_reply(conn, cookie, NULL);
+      TraceFlowEnd("GetProperty", cookie.sequence);
+      TraceEnd();
+    }
+    TraceEnd();
+    TraceDeinit();
+*/
+internal bool TraceInit(char *path);
+/*
+Writes the recorded events as JSON and releases them
+*/
+internal void TraceDeinit();
+
+internal void TraceBegin(const char *name);
+internal void TraceEnd();
+/*
+Flow arrows connect the slice enclosing TraceFlowStart to the one enclosing the matching
+TraceFlowEnd, id is typically an X request sequence number.
+*/
+internal void TraceFlowStart(const char *name, u64 id);
+internal void TraceFlowEnd(const char *name, u64 id);
+
+#endif
\ No newline at end of file
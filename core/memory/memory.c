@@ -1,6 +1,7 @@
 #include "memory.h"
 #include "../os/os.h"
 #include "../log/log.h"
+#include "../log/profile.h"
 
 internal b8 is_power_of_two(u64 x)
 {
@@ -43,6 +44,7 @@ internal void ArenaDeinit(Arena *arena)
 
 internal void *ArenaAlloc(Arena *arena, u64 size)
 {
+  ProfileZone("ArenaAlloc");
   void *result = NULL;
   if (size != 0)
   {
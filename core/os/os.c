@@ -1,3 +1,4 @@
 #include "os_virtual_mem.c"
 #include "os_time.c"
+#include "os_process.c"
 #include "os_filesystem.h"
\ No newline at end of file
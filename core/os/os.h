@@ -4,6 +4,7 @@
 #include "os_defines.h"
 #include "os_virtual_mem.h"
 #include "os_time.h"
+#include "os_process.h"
 #include "os_filesystem.c"
 
 #endif
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include <errno.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
 #include "os_time.h"
 #include "../log/log.h"
 
@@ -71,6 +73,25 @@ internal String Fs_ReadFileFull(Allocator allocator, String path)
   return Fs_ReadFileFullCstr(allocator, p);
 }
 
+internal FsMappedFile Fs_MapFile(Allocator allocator, String path)
+{
+  char *p = CstrFromStr(allocator, path);
+  return Fs_MapFileCstr(allocator, p);
+}
+
+internal void Fs_UnmapFile(Allocator allocator, FsMappedFile *file)
+{
+  if (file->mapped_size != 0)
+  {
+    munmap(file->content.data, file->mapped_size);
+  }
+  else if (file->buffer_capacity != 0)
+  {
+    Free(file->content.data, file->buffer_capacity);
+  }
+  *file = (FsMappedFile){0};
+}
+
 internal FsErrors Fs_WriteToFile(Allocator allocator, String path, String content)
 {
   char *p = CstrFromStr(allocator, path);
@@ -84,6 +105,98 @@ internal u64 Fs_LastModifiedTime(Allocator allocator, String path)
   return Fs_LastModifiedTimeCstr(p);
 }
 
+internal FsWatch Fs_WatchFile(Allocator allocator, String path)
+{
+  FsWatch watch = {0};
+  watch.fd      = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  watch.dir_wd  = -1;
+  watch.file_wd = -1;
+  if (watch.fd != -1)
+  {
+    i64    slash = -1;
+    String dir   = StrLit(".");
+    for (u64 i = 0; i < path.size; i += 1)
+    {
+      if (path.data[i] == '/')
+      {
+        slash = (i64)i;
+      }
+    }
+    if (slash != -1)
+    {
+      dir = slash == 0 ? StrLit("/") : StrSubstrTill(path, (u64)slash);
+    }
+    watch.name   = StrClone(allocator, StrSubstrFrom(path, (u64)(slash + 1)));
+    watch.path   = CstrFromStr(allocator, path);
+    watch.dir_wd = inotify_add_watch(watch.fd, CstrFromStr(allocator, dir),
+                                     IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    watch.file_wd = inotify_add_watch(watch.fd, watch.path, IN_MODIFY | IN_CLOSE_WRITE);
+    if (watch.dir_wd == -1 && watch.file_wd == -1)
+    {
+      Errorf("Failed to watch '%s' (errno: %d).", watch.path, errno);
+      Fs_WatchClose(&watch);
+    }
+  }
+  return watch;
+}
+
+internal bool Fs_WatchPoll(FsWatch *watch)
+{
+  bool changed = false;
+  if (watch->fd != -1)
+  {
+    // u64 elements keep the inotify_event headers aligned
+    u64 buffer_storage[512];
+    u8 *buffer = (u8 *)buffer_storage;
+    for (;;)
+    {
+      ssize_t size = read(watch->fd, buffer, sizeof buffer_storage);
+      if (size <= 0)
+      {
+        break;
+      }
+      for (ssize_t pos = 0; pos < size;)
+      {
+        struct inotify_event *event = (struct inotify_event *)(buffer + pos);
+        pos += sizeof(struct inotify_event) + event->len;
+        if (event->wd == watch->file_wd)
+        {
+          if (event->mask & IN_IGNORED)
+          {
+            watch->file_wd = -1;
+          }
+          else
+          {
+            changed = true;
+          }
+        }
+        else if (event->wd == watch->dir_wd && event->len != 0 &&
+                 StrEquals(StrCstr(event->name), watch->name))
+        {
+          changed = true;
+          // A new file took the watched name, follow it
+          if (event->mask & (IN_MOVED_TO | IN_CREATE))
+          {
+            watch->file_wd = inotify_add_watch(watch->fd, watch->path, IN_MODIFY | IN_CLOSE_WRITE);
+          }
+        }
+      }
+    }
+  }
+  return changed;
+}
+
+internal void Fs_WatchClose(FsWatch *watch)
+{
+  if (watch->fd != -1)
+  {
+    close(watch->fd);
+  }
+  watch->fd      = -1;
+  watch->dir_wd  = -1;
+  watch->file_wd = -1;
+}
+
 internal FsErrors Fs_CreateDirCstr(char *folder_name)
 {
   FsErrors err = FsErrors_None;
@@ -282,18 +395,10 @@ internal String Fs_ReadFileFullCstr(Allocator allocator, char *path)
   FILE  *file = fopen(path, "rb");
   if (file != NULL)
   {
-    if (fseek(file, 0, SEEK_END) != 0)
-    {
-      fclose(file);
-    }
-    else
+    if (fseek(file, 0, SEEK_END) == 0)
     {
       i64 file_size = ftell(file);
-      if (file_size == -1)
-      {
-        fclose(file);
-      }
-      else
+      if (file_size != -1)
       {
         rewind(file);
         res.data      = Alloc(u8, (u64)file_size);
@@ -301,7 +406,7 @@ internal String Fs_ReadFileFullCstr(Allocator allocator, char *path)
         if (read_size != (u64)file_size)
         {
           Free(res.data, (u64)file_size);
-          fclose(file);
+          res.data = NULL;
         }
         else
         {
@@ -314,6 +419,180 @@ internal String Fs_ReadFileFullCstr(Allocator allocator, char *path)
   return res;
 }
 
+/*
+Maps or reads the file behind fd, which stays owned by the caller
+*/
+internal FsMappedFile Fs_MapOpenedFile(Allocator allocator, int fd, struct stat file_stat)
+{
+  FsMappedFile res = {0};
+  if (S_ISREG(file_stat.st_mode) && (u64)file_stat.st_size >= FS_MAP_MIN_SIZE)
+  {
+    u64 size  = (u64)file_stat.st_size;
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    // Fault the whole file in up front, parsers read it front to back anyway
+    flags |= MAP_POPULATE;
+#endif
+    u8 *mapped = mmap(NULL, size, PROT_READ, flags, fd, 0);
+    if (mapped != MAP_FAILED)
+    {
+      posix_madvise(mapped, size, POSIX_MADV_SEQUENTIAL);
+      res.content     = Str(mapped, size);
+      res.mapped_size = size;
+    }
+  }
+  else
+  {
+    // Special files report a size of 0 or none at all, read till the end instead. Small files
+    // are read as well, a copy is cheap and can't fault if the file is truncated under it.
+    bool seekable = S_ISREG(file_stat.st_mode) || S_ISBLK(file_stat.st_mode);
+    u64  capacity = Kilobytes(4);
+    if (S_ISREG(file_stat.st_mode))
+    {
+      // One spare byte so the read that finds the end doesn't have to grow the buffer
+      capacity = Max(capacity, (u64)file_stat.st_size + 1);
+    }
+    u8  *buffer   = Alloc(u8, capacity);
+    u64  size     = 0;
+    for (bool reading = buffer != NULL; reading;)
+    {
+      if (size == capacity)
+      {
+        u8 *grown = Alloc(u8, capacity * 2);
+        if (grown)
+        {
+          memcpy(grown, buffer, size);
+        }
+        Free(buffer, capacity);
+        buffer = grown;
+        capacity *= 2;
+      }
+      ssize_t read_size = 0;
+      if (buffer)
+      {
+        read_size = seekable ? pread(fd, buffer + size, capacity - size, (off_t)size)
+                             : read(fd, buffer + size, capacity - size);
+      }
+      if (read_size > 0)
+      {
+        size += (u64)read_size;
+      }
+      else if (read_size == -1 && errno == EINTR)
+      {
+        continue;
+      }
+      else
+      {
+        reading = false;
+      }
+    }
+    if (buffer)
+    {
+      res.content         = Str(buffer, size);
+      res.buffer_capacity = capacity;
+    }
+  }
+  return res;
+}
+
+internal FsMappedFile Fs_MapFileCstr(Allocator allocator, char *path)
+{
+  FsMappedFile res = {0};
+  int          fd  = open(path, O_RDONLY | O_CLOEXEC);
+  struct stat  file_stat;
+  if (fd != -1 && fstat(fd, &file_stat) == 0)
+  {
+    res = Fs_MapOpenedFile(allocator, fd, file_stat);
+  }
+  if (fd != -1)
+  {
+    close(fd);
+  }
+  return res;
+}
+
+internal FsMappedFile Fs_MapPrivateFileCstr(Allocator allocator, char *path)
+{
+  FsMappedFile res = {0};
+  int          fd  = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+  struct stat  file_stat;
+  if (fd != -1 && fstat(fd, &file_stat) == 0)
+  {
+    // Checked on the opened file, so the name can't be swapped between the check and the read
+    if (!S_ISREG(file_stat.st_mode) || file_stat.st_uid != geteuid() ||
+        (file_stat.st_mode & (S_IWGRP | S_IWOTH)))
+    {
+      Errorf("Ignoring '%s', it is not a regular file that only its owner, this user, can write",
+             path);
+    }
+    else
+    {
+      res = Fs_MapOpenedFile(allocator, fd, file_stat);
+    }
+  }
+  if (fd != -1)
+  {
+    close(fd);
+  }
+  return res;
+}
+
+internal FsErrors Fs_ReplaceFileCstr(char *path, char *buffer, u64 buffer_size)
+{
+  FsErrors err = FsErrors_None;
+  char     tmp[4096];
+  int      fd = -1;
+  if (snprintf(tmp, sizeof tmp, "%s.%d.tmp", path, (int)getpid()) >= (int)sizeof tmp)
+  {
+    err = FsErrors_NameIsTooLong;
+  }
+  else
+  {
+    // A leftover of a crashed writer is removed once, anything else holding the name fails
+    for (u32 attempt = 0; fd == -1 && attempt < 2; attempt += 1)
+    {
+      fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+      if (fd == -1 && (errno != EEXIST || unlink(tmp) != 0))
+      {
+        break;
+      }
+    }
+    err = fd == -1 ? FsErrors_GeneralFileOpenError : FsErrors_None;
+  }
+  for (u64 written = 0; err == FsErrors_None && written < buffer_size;)
+  {
+    ssize_t size = write(fd, buffer + written, buffer_size - written);
+    if (size > 0)
+    {
+      written += (u64)size;
+    }
+    else if (size == -1 && errno == EINTR)
+    {
+      continue;
+    }
+    else
+    {
+      err = FsErrors_GeneralFileWriteError;
+    }
+  }
+  if (fd != -1)
+  {
+    if (close(fd) != 0 && err == FsErrors_None)
+    {
+      err = FsErrors_GeneralFileWriteError;
+    }
+    if (err == FsErrors_None && rename(tmp, path) != 0)
+    {
+      err = FsErrors_GeneralFileWriteError;
+    }
+    if (err != FsErrors_None)
+    {
+      unlink(tmp);
+    }
+  }
+  return err;
+}
+
 internal FsErrors Fs_WriteToFileCstr(char *path, char *buffer, u64 buffer_size)
 {
   FsErrors err = FsErrors_None;
@@ -71,9 +71,65 @@ Example:
 */
 internal String Fs_ReadFileFull(Allocator allocator, String path);
 
+// Regular files from this size on are mapped, smaller ones are read into a buffer
+#define FS_MAP_MIN_SIZE Kilobytes(256)
+
+/*
+Read-only view of a whole file. Regular files of at least FS_MAP_MIN_SIZE are mapped straight
+out of the page cache. Smaller ones, and files that don't report their size up front (pipes,
+/proc entries), are read into an allocator buffer instead. content is empty if the file
+couldn't be opened or read.
+A mapping reflects later writes to the file and truncating it makes pages past the new end
+fault with SIGBUS, keep views of files others may rewrite short-lived or small enough to be
+read, and copy out whatever has to outlive the file.
+Example:
+  FsMappedFile file = Fs_MapFile(allocator, path);
+  IniMap       map  = Ini_LoadMapFromString(allocator, file.content);
+  ...
+  Fs_UnmapFile(allocator, &file);
+*/
+typedef struct
+{
+  String content;
+  // Non-zero when content is a mapping, otherwise it's a buffer of buffer_capacity bytes
+  u64    mapped_size;
+  u64    buffer_capacity;
+} FsMappedFile;
+
+internal FsMappedFile Fs_MapFile(Allocator allocator, String path);
+internal void         Fs_UnmapFile(Allocator allocator, FsMappedFile *file);
+
 internal FsErrors Fs_WriteToFile(Allocator allocator, String path, String content);
 internal u64      Fs_LastModifiedTime(Allocator allocator, String path);
 
+/*
+Watches a file and the directory containing it, so editors which write a new file and rename
+it over the watched one are noticed as well. fd is -1 if the watch couldn't be set up, it is
+non-blocking and meant to be waited on with poll next to other descriptors.
+Example:
+  FsWatch watch = Fs_WatchFile(allocator, path);
+  struct pollfd pfd = {.fd = watch.fd, .events = POLLIN};
+  if (poll(&pfd, 1, -1) > 0 && Fs_WatchPoll(&watch))
+  {
+    Debugf("%.*s changed", StrFmtVal(path));
+  }
+*/
+typedef struct
+{
+  int    fd;
+  int    dir_wd;
+  int    file_wd;
+  char  *path;
+  String name;
+} FsWatch;
+
+internal FsWatch Fs_WatchFile(Allocator allocator, String path);
+/*
+Drains pending notifications, returns true if any of them concerned the watched file
+*/
+internal bool    Fs_WatchPoll(FsWatch *watch);
+internal void    Fs_WatchClose(FsWatch *watch);
+
 internal FsErrors Fs_CreateDirCstr(char *directory_path);
 internal FsErrors Fs_RemoveDirCstr(char *directory_path);
 internal bool     Fs_DirExistsCstr(char *directory_path);
@@ -84,7 +140,19 @@ internal FsErrors Fs_ReadDirCstr(Allocator allocator, char *directory_path,
 internal bool     Fs_IsFileCstr(char *path);
 internal FsErrors Fs_RemoveFileCstr(char *path);
 internal String   Fs_ReadFileFullCstr(Allocator allocator, char *path);
+internal FsMappedFile Fs_MapFileCstr(Allocator allocator, char *path);
+/*
+Fs_MapFileCstr for files whose content is trusted, like caches. Symlinks, files of other users
+and files others can write come back empty.
+*/
+internal FsMappedFile Fs_MapPrivateFileCstr(Allocator allocator, char *path);
 internal FsErrors Fs_WriteToFileCstr(char *path, char *buffer, u64 buffer_size);
+/*
+Writes a new file only the user can access next to path and renames it over path, readers see
+either the old content or the new one. The new file is created exclusively and never through a
+symlink.
+*/
+internal FsErrors Fs_ReplaceFileCstr(char *path, char *buffer, u64 buffer_size);
 internal u64      Fs_LastModifiedTimeCstr(char *path);
 
 #endif
\ No newline at end of file
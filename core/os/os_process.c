@@ -0,0 +1,231 @@
+#include "os_process.h"
+
+#ifdef OS_LINUX
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#include "../log/log.h"
+
+extern char **environ;
+
+// Closes the descriptors in the child, after the fork, so none opened meanwhile by another
+// thread can slip through. glibc has it since 2.34 but only declares it for _GNU_SOURCE builds.
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+#define PROCESS_HAS_CLOSEFROM
+extern int posix_spawn_file_actions_addclosefrom_np(posix_spawn_file_actions_t *actions, int from);
+#endif
+
+internal int Process_ReaperInit()
+{
+  int      fd = -1;
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  if (pthread_sigmask(SIG_BLOCK, &mask, NULL) == 0)
+  {
+    fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  }
+  return fd;
+}
+
+internal void Process_ReaperDeinit(int reaper_fd)
+{
+  if (reaper_fd != -1)
+  {
+    close(reaper_fd);
+  }
+}
+
+internal u32 Process_Reap(int reaper_fd, ProcessExit *exits, u32 capacity)
+{
+  // Signals coalesce, the signalfd only says that some children exited, waitpid says which
+  struct signalfd_siginfo infos[16];
+  while (reaper_fd != -1 && read(reaper_fd, infos, sizeof infos) > 0)
+  {
+  }
+  u32 count = 0;
+  while (count < capacity)
+  {
+    int status = 0;
+    i32 pid    = waitpid(-1, &status, WNOHANG);
+    if (pid <= 0)
+    {
+      break;
+    }
+    exits[count] = (ProcessExit){.pid = pid, .status = status};
+    count += 1;
+  }
+  return count;
+}
+
+internal bool Process_NeedsShell(String command)
+{
+  bool res = StrIndexAnyByte(command, StrLit("|&;<>()$`\\\"'*?[#~\n")) != -1;
+  // Only an assignment before the program name is shell syntax, --flag=value isn't
+  i64 equals = StrIndexByte(command, '=');
+  if (!res && equals != -1)
+  {
+    res = StrIndexAnyByte(StrSubstrTill(command, (u64)equals), StrLit(" \t")) == -1;
+  }
+  return res;
+}
+
+#ifndef PROCESS_HAS_CLOSEFROM
+// Fallback for older C libraries, a descriptor another thread opens during the walk without
+// O_CLOEXEC can still leak into the child
+internal void Process_MarkFdsCloseOnExec()
+{
+  DIR *dir = opendir("/proc/self/fd");
+  if (dir)
+  {
+    int            dir_fd = dirfd(dir);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+      int fd = atoi(entry->d_name);
+      if (fd > 2 && fd != dir_fd)
+      {
+        int flags = fcntl(fd, F_GETFD);
+        if (flags != -1 && !(flags & FD_CLOEXEC))
+        {
+          fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+        }
+      }
+    }
+    closedir(dir);
+  }
+}
+#endif
+
+internal i32 Process_Spawn(String command)
+{
+  i32   res = -1;
+  char  buffer[PROCESS_COMMAND_MAX];
+  char *argv[PROCESS_ARGS_MAX + 1];
+  u32   argc = 0;
+  if (command.size >= sizeof buffer)
+  {
+    Errorf("Command is longer than %d bytes: %.*s", PROCESS_COMMAND_MAX, StrFmtVal(command));
+  }
+  else
+  {
+    memcpy(buffer, command.data, command.size);
+    buffer[command.size] = '\0';
+    if (Process_NeedsShell(command))
+    {
+      argv[0] = "/bin/sh";
+      argv[1] = "-c";
+      argv[2] = buffer;
+      argc    = 3;
+    }
+    else
+    {
+      // Split in place, every run of blanks becomes a terminator
+      bool too_many = false;
+      for (u64 i = 0; !too_many && i < command.size; i += 1)
+      {
+        bool blank = buffer[i] == ' ' || buffer[i] == '\t';
+        if (blank)
+        {
+          buffer[i] = '\0';
+        }
+        else if (i == 0 || buffer[i - 1] == '\0')
+        {
+          too_many = argc == PROCESS_ARGS_MAX;
+          if (!too_many)
+          {
+            argv[argc] = &buffer[i];
+            argc += 1;
+          }
+        }
+      }
+      // Running the command without its last arguments could do something else entirely
+      if (too_many)
+      {
+        Errorf("Command has more than %d arguments: %.*s", PROCESS_ARGS_MAX, StrFmtVal(command));
+        argc = 0;
+      }
+    }
+    argv[argc] = NULL;
+  }
+
+  if (argc != 0)
+  {
+    // The child starts with nothing blocked, SIGCHLD is only blocked here for the signalfd
+    posix_spawnattr_t          attr;
+    posix_spawn_file_actions_t actions;
+    sigset_t                   empty;
+    sigemptyset(&empty);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &empty);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+    posix_spawn_file_actions_init(&actions);
+#ifdef PROCESS_HAS_CLOSEFROM
+    posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+#else
+    Process_MarkFdsCloseOnExec();
+#endif
+    pid_t pid   = 0;
+    int   error = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (error == 0)
+    {
+      res = pid;
+    }
+    else
+    {
+      Errorf("Failed to spawn '%.*s' (errno: %d).", StrFmtVal(command), error);
+    }
+  }
+  return res;
+}
+
+internal i32 Process_ParentPid(i32 pid)
+{
+  i32  res = -1;
+  char path[32];
+  snprintf(path, sizeof path, "/proc/%d/stat", pid);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd != -1)
+  {
+    char    buffer[512];
+    ssize_t size = read(fd, buffer, sizeof buffer);
+    close(fd);
+    if (size > 0)
+    {
+      // pid (comm) state ppid ..., comm may hold spaces and parentheses so look for the last ')'
+      String stat  = Str((u8 *)buffer, (u64)size);
+      i64    paren = -1;
+      for (u64 i = 0; i < stat.size; i += 1)
+      {
+        if (stat.data[i] == ')')
+        {
+          paren = (i64)i;
+        }
+      }
+      String rest = paren == -1 ? (String){0} : StrSubstrFrom(stat, (u64)paren + 1);
+      rest        = StrTrimLeft(rest, StrLit(" "));
+      // Skip the state field
+      i64 space = StrIndexByte(rest, ' ');
+      if (space != -1)
+      {
+        rest = StrSubstrFrom(rest, (u64)space + 1);
+        res  = 0;
+        for (u64 i = 0; i < rest.size && rest.data[i] >= '0' && rest.data[i] <= '9'; i += 1)
+        {
+          res = res * 10 + (rest.data[i] - '0');
+        }
+      }
+    }
+  }
+  return res;
+}
+
+#endif
\ No newline at end of file
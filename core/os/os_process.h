@@ -0,0 +1,60 @@
+#ifndef OS_PROCESS_H
+#define OS_PROCESS_H
+
+#include "os_defines.h"
+#include "../containers/string.h"
+// Included ahead of os_filesystem.c, which defines __USE_XOPEN2K8 and hides the W* macros after
+#include <sys/wait.h>
+
+// Longest command Process_Spawn splits on the stack, and the most arguments it passes on
+#define PROCESS_COMMAND_MAX 4096
+#define PROCESS_ARGS_MAX 128
+
+typedef struct
+{
+  i32 pid;
+  // As returned by waitpid, decode with WIFEXITED and friends
+  i32 status;
+} ProcessExit;
+
+/*
+Blocks SIGCHLD and returns a non-blocking signalfd reporting child exits, -1 on failure. Has to
+run before any thread is started, the log writer included. Threads inherit the blocked mask and
+a thread that doesn't block SIGCHLD would swallow it.
+Example:
+  int reaper_fd = Process_ReaperInit();
+  i32 pid       = Process_Spawn(StrLit("alacritty"));
+  struct pollfd pfd = {.fd = reaper_fd, .events = POLLIN};
+  if (poll(&pfd, 1, -1) > 0)
+  {
+    ProcessExit exits[16];
+    u32         count = Process_Reap(reaper_fd, exits, 16);
+  }
+*/
+internal int  Process_ReaperInit();
+internal void Process_ReaperDeinit(int reaper_fd);
+/*
+Collects up to capacity exited children without blocking. A result equal to capacity means more
+may be waiting, call again.
+*/
+internal u32  Process_Reap(int reaper_fd, ProcessExit *exits, u32 capacity);
+
+/*
+True if the command needs /bin/sh: quoting, expansions, redirections, pipes, lists or a leading
+variable assignment
+*/
+internal bool Process_NeedsShell(String command);
+/*
+Starts the command and returns its pid, -1 on failure. No allocation and no fork of the
+caller's address space, posix_spawn returns once the child has exec'd. Plain commands are split
+on whitespace and exec'd directly through PATH, the rest goes through /bin/sh -c. A plain
+command with more than PROCESS_ARGS_MAX arguments is refused rather than cut short. The child
+closes every descriptor above stderr before the exec, so it inherits none of ours.
+*/
+internal i32  Process_Spawn(String command);
+/*
+Reads the parent pid from /proc/<pid>/stat, -1 if the process is gone
+*/
+internal i32  Process_ParentPid(i32 pid);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,211 @@
+// Offline decoder of the binary journal written by the window manager (see wm/journal.h)
+//
+// Usage: journal <path> [-kind=event|error|request|action|layout] [-window=<id>]
+//                       [-min-duration-us=<n>] [-summary]
+// Window ids are decimal or 0x-prefixed hex, the way records print them
+
+#include "../core/core.h"
+#include "../wm/journal.h"
+
+#include "../core/core.c"
+#include "../wm/journal.c"
+
+typedef struct
+{
+  u64 count;
+  u64 total_duration;
+  u64 max_duration;
+} JournalStats;
+
+internal bool ParseFlag(String arg, String name, String *value)
+{
+  bool ok = false;
+  if (arg.size > name.size && StrEquals(StrSubstrTill(arg, name.size), name) &&
+      arg.data[name.size] == '=')
+  {
+    *value = StrSubstrFrom(arg, name.size + 1);
+    ok     = true;
+  }
+  return ok;
+}
+
+/*
+Decimal, or hex with a 0x prefix
+*/
+internal bool ParseWindowId(String value, u64 *id)
+{
+  bool ok = false;
+  if (value.size > 2 && value.data[0] == '0' && (value.data[1] == 'x' || value.data[1] == 'X'))
+  {
+    ok  = value.size <= 2 + 16;
+    *id = 0;
+    for (u64 i = 2; ok && i < value.size; i += 1)
+    {
+      u8 c     = value.data[i] | 0x20;
+      u8 digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : 16;
+      ok       = digit < 16;
+      *id      = (*id << 4) | digit;
+    }
+  }
+  else
+  {
+    ok = U64FromStr(value, id) == StrParseError_None;
+  }
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  Arena    *arena     = ArenaInit(Gigabytes(1));
+  Allocator allocator = ArenaAllocator(arena);
+  int       res       = 0;
+
+  i32  kind_filter   = -1;
+  u64  window_filter = 0;
+  u64  min_duration  = 0;
+  bool summary       = false;
+  for (int i = 2; i < argc; i += 1)
+  {
+    String arg = StrCstr(argv[i]);
+    String value;
+    // A filter that can't be applied would print everything, so it is an error instead
+    if (ParseFlag(arg, StrLit("-kind"), &value))
+    {
+      kind_filter = -1;
+      for (u16 kind = 0; kind < JournalKind_Count; kind += 1)
+      {
+        if (StrEquals(value, StrCstr((char *)JournalKindName(kind))))
+        {
+          kind_filter = kind;
+        }
+      }
+      if (kind_filter == -1)
+      {
+        Errorf("Unknown kind: %.*s, expected event, error, request, action or layout",
+               StrFmtVal(value));
+        res = 1;
+      }
+    }
+    else if (ParseFlag(arg, StrLit("-window"), &value))
+    {
+      if (!ParseWindowId(value, &window_filter))
+      {
+        Errorf("Invalid window id: %.*s", StrFmtVal(value));
+        res = 1;
+      }
+    }
+    else if (ParseFlag(arg, StrLit("-min-duration-us"), &value))
+    {
+      if (U64FromStr(value, &min_duration) == StrParseError_None)
+      {
+        min_duration = Microsecons(min_duration);
+      }
+      else
+      {
+        Errorf("Invalid duration: %.*s", StrFmtVal(value));
+        res = 1;
+      }
+    }
+    else if (StrEquals(arg, StrLit("-summary")))
+    {
+      summary = true;
+    }
+    else
+    {
+      Errorf("Unknown argument: %s", argv[i]);
+      res = 1;
+    }
+  }
+
+  String file = {0};
+  if (argc < 2)
+  {
+    Error("Syntax: journal <path> [-kind=<kind>] [-window=<id>] [-min-duration-us=<n>] "
+          "[-summary]");
+    res = 1;
+  }
+  else if (res == 0)
+  {
+    file = Fs_ReadFileFull(allocator, StrCstr(argv[1]));
+  }
+
+  JournalHeader *header = (JournalHeader *)file.data;
+  if (res == 0 && (file.size < sizeof(JournalHeader) ||
+                   memcmp(header->magic, JOURNAL_MAGIC, sizeof header->magic) != 0 ||
+                   header->record_size != sizeof(JournalRecord) ||
+                   file.size < sizeof(JournalHeader) + sizeof(JournalRecord) * header->capacity))
+  {
+    Errorf("%s is not a journal written by this version of the window manager", argv[1]);
+    res = 1;
+  }
+
+  if (res == 0)
+  {
+    JournalRecord *records = (JournalRecord *)(header + 1);
+    u64            first   = header->head > header->capacity ? header->head - header->capacity : 0;
+    JournalStats  *stats   = Alloc(JournalStats, JournalKind_Count * 65536);
+    u64            shown   = 0;
+    u64            torn    = 0;
+    printf("records %llu..%llu (%llu overwritten)\n", (unsigned long long)first,
+           (unsigned long long)header->head, (unsigned long long)first);
+    for (u64 i = first; i < header->head; i += 1)
+    {
+      JournalRecord *record = &records[i % header->capacity];
+      // Claimed but never finished (a crash) or being written while the file was read
+      if (record->commit != i + 1)
+      {
+        torn += 1;
+        continue;
+      }
+      if ((kind_filter != -1 && record->kind != kind_filter) ||
+          (window_filter != 0 && record->window != window_filter) ||
+          record->duration < min_duration || record->kind >= JournalKind_Count)
+      {
+        continue;
+      }
+      shown += 1;
+      if (summary)
+      {
+        JournalStats *s = &stats[record->kind * 65536 + record->code];
+        s->count += 1;
+        s->total_duration += record->duration;
+        s->max_duration = Max(s->max_duration, record->duration);
+      }
+      else
+      {
+        f64 at = (f64)(record->start - header->start_time) / (f64)Seconds(1);
+        printf("%12.6f %-8s %3u %-24s window: 0x%08x seq: %5u dur: %8.1fus args: %u %u %u\n",
+               at, JournalKindName(record->kind), record->code,
+               JournalCodeName(record->kind, record->code), record->window, record->sequence,
+               (f64)record->duration / (f64)Microsecons(1), record->arg0, record->arg1,
+               record->arg2);
+      }
+    }
+    if (summary)
+    {
+      printf("%-8s %5s %-24s %10s %12s %12s\n", "kind", "code", "name", "count", "avg us",
+             "max us");
+      for (u64 i = 0; i < JournalKind_Count * 65536; i += 1)
+      {
+        JournalStats *s = &stats[i];
+        if (s->count != 0)
+        {
+          u16 kind = (u16)(i / 65536);
+          u16 code = (u16)(i % 65536);
+          printf("%-8s %5u %-24s %10llu %12.1f %12.1f\n", JournalKindName(kind), code,
+                 JournalCodeName(kind, code), (unsigned long long)s->count,
+                 (f64)s->total_duration / (f64)s->count / (f64)Microsecons(1),
+                 (f64)s->max_duration / (f64)Microsecons(1));
+        }
+      }
+    }
+    printf("%llu records matched\n", (unsigned long long)shown);
+    if (torn != 0)
+    {
+      printf("%llu records skipped, not completely written\n", (unsigned long long)torn);
+    }
+  }
+
+  ArenaDeinit(arena);
+  return res;
+}
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "bsp.h"
+
+// Pool indices stay below this so the u16 capacity can always double
+#define BSP_MAX_NODES INT16_MAX
+
+internal BspTree BspInit()
+{
+  BspTree res = {0};
+  res.root    = BSP_NONE;
+  res.free    = BSP_NONE;
+  res.dirty   = BSP_NONE;
+  return res;
+}
+
+internal void BspDeinit(Allocator allocator, BspTree *tree)
+{
+  ArrayBspNode_Deinit(allocator, &tree->nodes);
+  tree->root  = BSP_NONE;
+  tree->free  = BSP_NONE;
+  tree->dirty = BSP_NONE;
+}
+
+internal void BspReset(BspTree *tree)
+{
+  tree->nodes.size = 0;
+  tree->root       = BSP_NONE;
+  tree->free       = BSP_NONE;
+  tree->dirty      = BSP_NONE;
+}
+
+internal u16 BspAllocNode(Allocator allocator, BspTree *tree)
+{
+  u16     res  = BSP_NONE;
+  BspNode node = {
+      .parent     = BSP_NONE,
+      .children   = {BSP_NONE, BSP_NONE},
+      .next_dirty = BSP_NONE,
+      .ratio      = 0.5f,
+  };
+  if (tree->free != BSP_NONE)
+  {
+    // A node still in the dirty list stays linked, it is only laid out once more
+    res                   = tree->free;
+    BspNode *old          = &tree->nodes.data[res];
+    tree->free            = old->parent;
+    node.flags            = old->flags & BspNodeFlag_Dirty;
+    node.next_dirty       = old->next_dirty;
+    tree->nodes.data[res] = node;
+  }
+  else if (tree->nodes.size < BSP_MAX_NODES &&
+           ArrayBspNode_Push(allocator, &tree->nodes, node) == AllocationError_None)
+  {
+    res = tree->nodes.size - 1;
+  }
+  return res;
+}
+
+internal void BspFreeNode(BspTree *tree, u16 index)
+{
+  tree->nodes.data[index].parent = tree->free;
+  tree->nodes.data[index].flags |= BspNodeFlag_Free;
+  tree->free                     = index;
+}
+
+internal void BspMarkDirty(BspTree *tree, u16 index)
+{
+  BspNode *node = &tree->nodes.data[index];
+  if (!(node->flags & BspNodeFlag_Dirty))
+  {
+    node->flags      |= BspNodeFlag_Dirty;
+    node->next_dirty  = tree->dirty;
+    tree->dirty       = index;
+  }
+}
+
+/*
+Points whatever referenced old, the parent's child slot or the root, at new
+*/
+internal void BspReplace(BspTree *tree, u16 old, u16 new)
+{
+  u16 parent                   = tree->nodes.data[old].parent;
+  tree->nodes.data[new].parent = parent;
+  if (parent == BSP_NONE)
+  {
+    tree->root = new;
+  }
+  else
+  {
+    BspNode *node = &tree->nodes.data[parent];
+    node->children[node->children[0] == old ? 0 : 1] = new;
+  }
+}
+
+internal u16 BspInsert(Allocator allocator, BspTree *tree, u16 leaf, xcb_window_t window)
+{
+  ProfileZone("BspInsert");
+  u16 res = BspAllocNode(allocator, tree);
+  if (res != BSP_NONE)
+  {
+    tree->nodes.data[res].window = window;
+    u16 target                   = leaf == BSP_NONE ? tree->root : leaf;
+    if (target == BSP_NONE)
+    {
+      tree->root = res;
+      BspMarkDirty(tree, res);
+    }
+    else
+    {
+      // The target keeps its index, so does every leaf
+      u16 split = BspAllocNode(allocator, tree);
+      if (split == BSP_NONE)
+      {
+        BspFreeNode(tree, res);
+        res = BSP_NONE;
+      }
+      else
+      {
+        BspReplace(tree, target, split);
+        tree->nodes.data[split].children[0] = target;
+        tree->nodes.data[split].children[1] = res;
+        tree->nodes.data[target].parent     = split;
+        tree->nodes.data[res].parent        = split;
+        BspMarkDirty(tree, split);
+      }
+    }
+  }
+  return res;
+}
+
+internal void BspRemove(BspTree *tree, u16 leaf)
+{
+  ProfileZone("BspRemove");
+  u16 parent = tree->nodes.data[leaf].parent;
+  if (parent == BSP_NONE)
+  {
+    tree->root = BSP_NONE;
+  }
+  else
+  {
+    BspNode *node    = &tree->nodes.data[parent];
+    u16      sibling = node->children[node->children[0] == leaf ? 1 : 0];
+    // The sibling is laid out again over the parent's rect, the rest of the tree stays
+    BspReplace(tree, parent, sibling);
+    BspMarkDirty(tree, sibling);
+    BspFreeNode(tree, parent);
+  }
+  BspFreeNode(tree, leaf);
+}
+
+/*
+Splits along the longer side, children[0] gets the left or top part
+*/
+internal void BspSplit(Rect rect, f32 ratio, i32 gap, Rect halves[2])
+{
+  bool side_by_side = rect.width >= rect.height;
+  i32  size         = side_by_side ? rect.width : rect.height;
+  i32  usable       = Max(size - gap, 2);
+  i32  first        = Clamp(1, (i32)((f32)usable * ratio), usable - 1);
+  halves[0]         = rect;
+  halves[1]         = rect;
+  if (side_by_side)
+  {
+    halves[0].width = (u16)first;
+    halves[1].x     = (i16)Min(rect.x + first + gap, INT16_MAX);
+    halves[1].width = (u16)(usable - first);
+  }
+  else
+  {
+    halves[0].height = (u16)first;
+    halves[1].y      = (i16)Min(rect.y + first + gap, INT16_MAX);
+    halves[1].height = (u16)(usable - first);
+  }
+}
+
+internal bool BspResize(BspTree *tree, u16 leaf, Axis axis, i32 amount)
+{
+  bool res = false;
+  for (u16 child = leaf, parent = tree->nodes.data[leaf].parent; !res && parent != BSP_NONE;
+       child = parent, parent = tree->nodes.data[parent].parent)
+  {
+    BspNode *node         = &tree->nodes.data[parent];
+    bool     side_by_side = node->rect.width >= node->rect.height;
+    if (side_by_side == (axis == Axis_Horizontal))
+    {
+      i32 size  = side_by_side ? node->rect.width : node->rect.height;
+      f32 delta = (f32)amount / (f32)Max(size, 1);
+      node->ratio += node->children[0] == child ? delta : -delta;
+      node->ratio = Clamp(0.05f, node->ratio, 0.95f);
+      BspMarkDirty(tree, parent);
+      res = true;
+    }
+  }
+  return res;
+}
+
+internal void BspInvalidate(BspTree *tree)
+{
+  if (tree->root != BSP_NONE)
+  {
+    BspMarkDirty(tree, tree->root);
+  }
+}
+
+internal u64 BspLayoutNode(BspTree *tree, u16 index, Rect rect, i32 gap, i32 border,
+                           WindowsSystem *windows)
+{
+  u64      res  = 0;
+  BspNode *node = &tree->nodes.data[index];
+  node->rect    = rect;
+  node->flags   = 0;
+  if (node->children[0] == BSP_NONE)
+  {
+    i32 window = WindowsSystemFind(windows, node->window);
+    if (window != -1)
+    {
+      windows->xs[window]      = rect.x;
+      windows->ys[window]      = rect.y;
+      windows->widths[window]  = (u16)Max((i32)rect.width - 2 * border, 1);
+      windows->heights[window] = (u16)Max((i32)rect.height - 2 * border, 1);
+    }
+    res = 1;
+  }
+  else
+  {
+    Rect halves[2];
+    BspSplit(rect, node->ratio, gap, halves);
+    res += BspLayoutNode(tree, node->children[0], halves[0], gap, border, windows);
+    res += BspLayoutNode(tree, node->children[1], halves[1], gap, border, windows);
+  }
+  return res;
+}
+
+internal u64 BspLayout(BspTree *tree, Rect area, i32 gap, i32 border, WindowsSystem *windows)
+{
+  ProfileZone("BspLayout");
+  u64 res = 0;
+  // The root follows the available space, a move of it is a full recompute
+  if (tree->root != BSP_NONE &&
+      memcmp(&tree->nodes.data[tree->root].rect, &area, sizeof(Rect)) != 0)
+  {
+    BspMarkDirty(tree, tree->root);
+  }
+  u16 next = BSP_NONE;
+  for (u16 i = tree->dirty; i != BSP_NONE; i = next)
+  {
+    BspNode *node = &tree->nodes.data[i];
+    next          = node->next_dirty;
+    // A dirty parent is still ahead in the list and lays this one out with it. Splits made in a
+    // row nest like that, which keeps a burst of inserts linear.
+    BspNode *parent = node->parent == BSP_NONE ? NULL : &tree->nodes.data[node->parent];
+    if ((node->flags & (BspNodeFlag_Dirty | BspNodeFlag_Free)) == BspNodeFlag_Dirty &&
+        !(parent && (parent->flags & BspNodeFlag_Dirty)))
+    {
+      Rect rect = area;
+      if (parent)
+      {
+        Rect halves[2];
+        BspSplit(parent->rect, parent->ratio, gap, halves);
+        rect = halves[parent->children[0] == i ? 0 : 1];
+      }
+      res += BspLayoutNode(tree, i, rect, gap, border, windows);
+    }
+    node->flags      &= ~BspNodeFlag_Dirty;
+    node->next_dirty  = BSP_NONE;
+  }
+  tree->dirty = BSP_NONE;
+  return res;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef WM_BSP_H
+#define WM_BSP_H
+
+#include "../core/core.h"
+#include "config.h"
+#include "window.h"
+#include <xcb/xproto.h>
+
+// Node index meaning no node: the parent of the root, the children of a leaf, an empty tree
+#define BSP_NONE UINT16_MAX
+
+typedef enum : u8
+{
+  // The node's rect changed, its whole subtree is computed again
+  BspNodeFlag_Dirty = 1 << 0,
+  // Back in the pool, may still be linked in the dirty list
+  BspNodeFlag_Free  = 1 << 1,
+} BspNodeFlag;
+
+/*
+Fixed-size pool entry, free nodes are chained through parent
+*/
+typedef struct
+{
+  u16          parent;
+  u16          children[2];
+  u8           flags;
+  // Kept while the node is in the pool, the dirty list may run through it
+  u16          next_dirty;
+  // Share of the rect, less the gap, that children[0] gets
+  f32          ratio;
+  Rect         rect;
+  // Leaves only
+  xcb_window_t window;
+} BspNode;
+
+ArrayTemplatePrefixIndexType(BspNode, ArrayBspNode, ArrayBspNode_, u16);
+ArrayTemplatePrefix(u16, ArrayBspIndex, ArrayBspIndex_);
+
+/*
+Binary space partition of a workspace. Leaves hold windows, inner nodes split their rect in two
+along its longer side, so the split direction follows the aspect ratio of the parent.
+Insert, remove and resize link the node whose rect changes into a dirty list, no allocation and
+no walk up to the root. A layout pass computes each listed subtree again from the rect its
+parent kept, so the cost does not depend on the depth. Everything else keeps its geometry.
+Example:
+  BspTree tree = BspInit();
+  u16     a    = BspInsert(allocator, &tree, BSP_NONE, window_a);
+  u16     b    = BspInsert(allocator, &tree, a, window_b);
+  BspLayout(&tree, area, gap, border, &windows);
+  BspRemove(&tree, a);
+  BspLayout(&tree, area, gap, border, &windows);
+*/
+typedef struct
+{
+  ArrayBspNode nodes;
+  u16          root;
+  u16          free;
+  // Roots of the subtrees to compute again, linked through next_dirty
+  u16          dirty;
+} BspTree;
+
+/*
+Empty, the pool is allocated by the first insert
+*/
+internal BspTree BspInit();
+internal void    BspDeinit(Allocator allocator, BspTree *tree);
+internal void    BspReset(BspTree *tree);
+/*
+Splits the leaf in two, its window keeps the first half and the new one gets the second. A
+BSP_NONE leaf splits the root, or makes the window the root of an empty tree. Returns the new
+leaf, BSP_NONE if the pool is full.
+*/
+internal u16     BspInsert(Allocator allocator, BspTree *tree, u16 leaf, xcb_window_t window);
+/*
+The sibling takes the place of the parent, both the leaf and the parent go back to the pool
+*/
+internal void    BspRemove(BspTree *tree, u16 leaf);
+/*
+Grows the leaf by amount pixels, negative shrinks it, along the axis by moving the nearest split
+across it. False if no split runs across that axis.
+*/
+internal bool    BspResize(BspTree *tree, u16 leaf, Axis axis, i32 amount);
+internal void    BspInvalidate(BspTree *tree);
+/*
+Computes the dirty subtrees again and writes the leaves' X geometry, the border excluded, into
+the WindowsSystem columns. Returns the number of leaves laid out.
+*/
+internal u64     BspLayout(BspTree *tree, Rect area, i32 gap, i32 border, WindowsSystem *windows);
+
+#endif
\ No newline at end of file
@@ -1,46 +1,721 @@
 #include "config.h"
+#include <pthread.h>
+#include <X11/Xlib.h>
 
-u64 g_last_mod_time = 0;
+// A burst of writes closer together than this is parsed once
+#define CONFIG_RELOAD_DEBOUNCE Milliseconds(50)
 
-internal bool LoadConfig(Allocator allocator, Config *config)
+String  g_config_path;
+char   *g_config_cache_path;
+FsWatch g_config_watch = {.fd = -1};
+// 0 when no reload is pending
+u64     g_config_reload_at;
+
+// Reloads are parsed on a loader thread and handed over through g_config_pending
+typedef struct
 {
-  bool   updated       = false;
-  String root          = StrLit(PROJECT_DIR);
-  String path          = Fs_PathJoin(allocator, root, StrLit("config.ini"));
-  u64    last_mod_time = Fs_LastModifiedTime(allocator, path);
-  if (g_last_mod_time < last_mod_time)
+  pthread_t       thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t  wake;
+  bool            reload_requested;
+  bool            quit;
+  bool            running;
+} ConfigLoader;
+
+ConfigLoader g_config_loader = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+                                .wake  = PTHREAD_COND_INITIALIZER};
+Config      *g_config_pending;
+
+internal void *ConfigLoaderThread(void *arg)
+{
+  (void)arg;
+  pthread_mutex_lock(&g_config_loader.mutex);
+  while (!g_config_loader.quit)
   {
-    Debug("Loading updated config from disk");
-    g_last_mod_time   = last_mod_time;
-    IniMap config_map = Ini_LoadMapFromPath(allocator, path);
-    // ArrayPair_StringToIniSection sections   = IniMap_KeyValuePairs(allocator, config_map);
-    // Debugf("config sections: %zu", sections.size);
-    // for (u64 i = 0; i < sections.size; i += 1)
-    // {
-    //   Debugf("%zuth: %.*s", i, StrFmtVal(sections.data[i].key));
-    // }
-    bool        valid         = true;
-    IniSection *style_section = IniMap_Find(&config_map, StrLit("style"));
-    if (style_section == NULL || style_section->tag != IniSection_Map)
+    if (!g_config_loader.reload_requested)
     {
-      valid = false;
-      Errorf("Config: style section was not found in the config file at %.*s", StrFmtVal(path));
+      pthread_cond_wait(&g_config_loader.wake, &g_config_loader.mutex);
     }
-    IniSection *startup_actions_section = IniMap_Find(&config_map, StrLit("startup_actions"));
-    if (startup_actions_section == NULL || startup_actions_section->tag != IniSection_Array)
+    else
     {
-      valid = false;
-      Errorf("Config: startup_actions section was not found in the config file at %.*s",
-             StrFmtVal(path));
+      g_config_loader.reload_requested = false;
+      pthread_mutex_unlock(&g_config_loader.mutex);
+      Config *config = LoadConfig();
+      if (config)
+      {
+        // A snapshot the event thread didn't pick up yet is superseded
+        Config *superseded = __atomic_exchange_n(&g_config_pending, config, __ATOMIC_ACQ_REL);
+        ConfigFree(superseded);
+      }
+      pthread_mutex_lock(&g_config_loader.mutex);
     }
-    IniSection *keymap_section = IniMap_Find(&config_map, StrLit("keymap"));
-    if (keymap_section == NULL || keymap_section->tag != IniSection_Array)
+  }
+  pthread_mutex_unlock(&g_config_loader.mutex);
+  return NULL;
+}
+
+/*
+$XDG_CACHE_HOME/x11_wm/config.cache, ~/.cache when it isn't set. The cache carries exec commands,
+so it is kept out of shared directories like /tmp where others could plant one. NULL, no cache,
+without a home directory.
+*/
+internal char *ConfigDefaultCachePath(Allocator allocator)
+{
+  char  *res        = NULL;
+  char  *cache_home = getenv("XDG_CACHE_HOME");
+  char  *home       = getenv("HOME");
+  String dir        = {0};
+  // The spec ignores relative paths
+  if (cache_home && cache_home[0] == '/')
+  {
+    dir = StrCstr(cache_home);
+  }
+  else if (home && home[0] == '/')
+  {
+    dir = Fs_PathJoin(allocator, StrCstr(home), StrLit(".cache"));
+    Fs_CreateDir(allocator, dir);
+  }
+  if (dir.size != 0)
+  {
+    dir          = Fs_PathJoin(allocator, dir, StrLit("x11_wm"));
+    FsErrors err = Fs_CreateDir(allocator, dir);
+    if (err == FsErrors_None || err == FsErrors_FolderAlreadyExists)
     {
-      valid = false;
-      Errorf("Config: keymap section was not found in the config file at %.*s", StrFmtVal(path));
+      res = CstrFromStr(allocator, Fs_PathJoin(allocator, dir, StrLit("config.cache")));
     }
-    if (valid)
+  }
+  return res;
+}
+
+internal int ConfigInit(Allocator allocator)
+{
+  g_config_path       = Fs_PathJoin(allocator, StrLit(PROJECT_DIR), StrLit("config.ini"));
+  char *cache_path    = getenv("WM_CONFIG_CACHE");
+  g_config_cache_path = cache_path ? cache_path : ConfigDefaultCachePath(allocator);
+  if (!g_config_cache_path)
+  {
+    Info("Config: no cache directory, every load parses the file");
+  }
+  g_config_watch = Fs_WatchFile(allocator, g_config_path);
+  if (pthread_create(&g_config_loader.thread, NULL, ConfigLoaderThread, NULL) == 0)
+  {
+    g_config_loader.running = true;
+  }
+  else
+  {
+    Error("Config: failed to start the loader thread, reloads are parsed on the event thread");
+  }
+  return g_config_watch.fd;
+}
+
+internal void ConfigDeinit()
+{
+  if (g_config_loader.running)
+  {
+    pthread_mutex_lock(&g_config_loader.mutex);
+    g_config_loader.quit = true;
+    pthread_cond_signal(&g_config_loader.wake);
+    pthread_mutex_unlock(&g_config_loader.mutex);
+    pthread_join(g_config_loader.thread, NULL);
+    g_config_loader.running = false;
+  }
+  ConfigFree(__atomic_exchange_n(&g_config_pending, NULL, __ATOMIC_ACQ_REL));
+  Fs_WatchClose(&g_config_watch);
+}
+
+internal bool ConfigReloadDue(u64 now)
+{
+  bool due = false;
+  if (Fs_WatchPoll(&g_config_watch))
+  {
+    g_config_reload_at = now + CONFIG_RELOAD_DEBOUNCE;
+  }
+  if (g_config_reload_at != 0 && now >= g_config_reload_at)
+  {
+    g_config_reload_at = 0;
+    due                = true;
+  }
+  return due;
+}
+
+internal void ConfigRequestReload()
+{
+  if (g_config_loader.running)
+  {
+    pthread_mutex_lock(&g_config_loader.mutex);
+    g_config_loader.reload_requested = true;
+    pthread_cond_signal(&g_config_loader.wake);
+    pthread_mutex_unlock(&g_config_loader.mutex);
+  }
+  else
+  {
+    Config *config = LoadConfig();
+    if (config)
+    {
+      ConfigFree(__atomic_exchange_n(&g_config_pending, config, __ATOMIC_ACQ_REL));
+    }
+  }
+}
+
+internal Config *ConfigTakeReloaded()
+{
+  return __atomic_exchange_n(&g_config_pending, NULL, __ATOMIC_ACQ_REL);
+}
+
+internal void ConfigFree(Config *config)
+{
+  if (config)
+  {
+    Fs_UnmapFile(ArenaAllocator(config->arena), &config->cache);
+    ArenaDeinit(config->arena);
+  }
+}
+
+/*
+Keys pack the modifier mask above the keysym, X never hands out keysym 0 so 0 marks empty slots
+*/
+internal u64 BindingSetHash(u64 key, u64 max)
+{
+  return (key * 11400714819323198485ull >> 32) % max;
+}
+
+internal bool BindingSetKeyEquals(u64 lhs, u64 rhs)
+{
+  return lhs == rhs;
+}
+
+internal bool BindingSetKeyIsEmpty(u64 key)
+{
+  return key == 0;
+}
+
+EmptyKeyValueFuncTemplate(u64, u32);
+HashMapTemplateFull(u64, u32, BindingSet, BindingSet_, BindingSetHash, BindingSetKeyEquals,
+                    BindingSetKeyIsEmpty, EmptyKeyValueDefault_u64_u32, u64);
+
+internal u64 BindingKey(const KeyBinding *binding)
+{
+  return ((u64)binding->modifiers << 32) | binding->keysym;
+}
+
+internal BindingSet BindingSetFromBindings(Allocator allocator, ArrayKeyBinding bindings)
+{
+  BindingSet res = BindingSet_Init(allocator, Max(bindings.size * 2, 1));
+  for (u64 i = 0; i < bindings.size; i += 1)
+  {
+    BindingSet_Push(allocator, &res, BindingKey(&bindings.data[i]), (u32)i);
+  }
+  return res;
+}
+
+/*
+Pushes every binding whose key combination is missing from the other set
+*/
+internal void BindingSetDifference(Allocator allocator, ArrayKeyBinding bindings,
+                                   BindingSet *other, ArrayKeyBinding *dest)
+{
+  for (u64 i = 0; i < bindings.size; i += 1)
+  {
+    if (!other || !BindingSet_Find(other, BindingKey(&bindings.data[i])))
+    {
+      ArrayKeyBinding_Push(allocator, dest, bindings.data[i]);
+    }
+  }
+}
+
+internal u16 KeyModifierFromName(String name)
+{
+  u16 res = 0;
+  if (StrEquals(name, StrLit("Alt")) || StrEquals(name, StrLit("Mod1")))
+  {
+    res = Mod1Mask;
+  }
+  else if (StrEquals(name, StrLit("Ctrl")) || StrEquals(name, StrLit("Control")))
+  {
+    res = ControlMask;
+  }
+  else if (StrEquals(name, StrLit("Shift")))
+  {
+    res = ShiftMask;
+  }
+  else if (StrEquals(name, StrLit("Super")) || StrEquals(name, StrLit("Mod4")))
+  {
+    res = Mod4Mask;
+  }
+  return res;
+}
+
+/*
+Resolves "Alt+Shift+H" into a modifier mask and a keysym, false if any part is unknown.
+Keysyms don't depend on the keyboard layout, only keycodes do, so this needs no connection.
+*/
+internal bool KeyComboParse(String combo, u16 *modifiers, u32 *keysym)
+{
+  bool         ok   = true;
+  String       key  = {0};
+  String       part = {0};
+  StrSplitIter it   = StrSplitIterInit(combo, StrLit("+"));
+  *modifiers        = 0;
+  *keysym           = NoSymbol;
+  while (ok && StrSplitIterNext(&it, &part))
+  {
+    // Every part but the last one is a modifier
+    if (!StrIsEmpty(key))
+    {
+      u16 modifier = KeyModifierFromName(key);
+      ok           = modifier != 0;
+      *modifiers |= modifier;
+    }
+    key = part;
+  }
+  if (StrEquals(key, StrLit("Enter")))
+  {
+    key = StrLit("Return");
+  }
+  char name[64];
+  ok = ok && !StrIsEmpty(key) && key.size < sizeof name;
+  if (ok)
+  {
+    memcpy(name, key.data, key.size);
+    name[key.size] = '\0';
+    *keysym        = (u32)XStringToKeysym(name);
+    ok             = *keysym != NoSymbol;
+  }
+  return ok;
+}
+
+/*
+Splits off the next blank separated token
+*/
+internal String ConfigNextToken(String *rest)
+{
+  String s     = StrTrimLeft(*rest, StrLit(" \t"));
+  i64    end   = StrIndexAnyByte(s, StrLit(" \t"));
+  String token = end == -1 ? s : StrSubstrTill(s, (u64)end);
+  *rest        = StrSubstrFrom(s, token.size);
+  return token;
+}
+
+internal bool DirectionFromString(String s, Direction *direction)
+{
+  bool ok = true;
+  if (StrEquals(s, StrLit("left")))
+  {
+    *direction = Direction_Left;
+  }
+  else if (StrEquals(s, StrLit("right")))
+  {
+    *direction = Direction_Right;
+  }
+  else if (StrEquals(s, StrLit("up")))
+  {
+    *direction = Direction_Up;
+  }
+  else if (StrEquals(s, StrLit("down")))
+  {
+    *direction = Direction_Down;
+  }
+  else
+  {
+    ok = false;
+  }
+  return ok;
+}
+
+internal bool U16FromToken(String s, u16 *value)
+{
+  u64  num = 0;
+  bool ok  = U64FromStr(s, &num) == StrParseError_None && num <= UINT16_MAX;
+  if (ok)
+  {
+    *value = (u16)num;
+  }
+  return ok;
+}
+
+const char *g_key_action_op_names[KeyActionOp_Count] = {
+    [KeyActionOp_None]                         = "none",
+    [KeyActionOp_FocusWindow]                  = "focus_window",
+    [KeyActionOp_MoveWindow]                   = "move_window",
+    [KeyActionOp_WindowSizeChange]             = "window_size_change",
+    [KeyActionOp_Exec]                         = "exec",
+    [KeyActionOp_ExecBackground]               = "exec_background",
+    [KeyActionOp_KillFocusedWindow]            = "kill_focused_window",
+    [KeyActionOp_RestartWindowManager]         = "restart_window_manager",
+    [KeyActionOp_ExitWindowManager]            = "exit_window_manager",
+    [KeyActionOp_SwitchToWorkspace]            = "switch_to_workspace",
+    [KeyActionOp_MoveFocusedWindowToWorkspace] = "move_focused_window_to_workspace",
+};
+
+internal const char *KeyActionOpName(KeyActionOp op)
+{
+  return op < KeyActionOp_Count ? g_key_action_op_names[op] : "";
+}
+
+/*
+Decodes the action part of a keymap line, the command span is stored relative to the line
+*/
+internal bool KeyActionParse(String line, String text, KeyAction *action)
+{
+  bool   ok   = false;
+  String rest = text;
+  String name = ConfigNextToken(&rest);
+  *action     = (KeyAction){0};
+  for (u32 op = KeyActionOp_None + 1; op < KeyActionOp_Count; op += 1)
+  {
+    if (StrEquals(name, StrCstr((char *)g_key_action_op_names[op])))
+    {
+      action->op = (KeyActionOp)op;
+      break;
+    }
+  }
+  switch (action->op)
+  {
+  case KeyActionOp_FocusWindow:
+    ok = DirectionFromString(ConfigNextToken(&rest), &action->arg.direction);
+    break;
+  case KeyActionOp_MoveWindow:
+    ok = DirectionFromString(ConfigNextToken(&rest), &action->arg.move.direction) &&
+         U16FromToken(ConfigNextToken(&rest), &action->arg.move.amount);
+    break;
+  case KeyActionOp_WindowSizeChange:
+  {
+    String axis = ConfigNextToken(&rest);
+    ok          = StrEquals(axis, StrLit("horizontal")) || StrEquals(axis, StrLit("vertical"));
+    action->arg.resize.axis =
+        StrEquals(axis, StrLit("horizontal")) ? Axis_Horizontal : Axis_Vertical;
+    ok = ok && U16FromToken(ConfigNextToken(&rest), &action->arg.resize.amount);
+    break;
+  }
+  case KeyActionOp_Exec:
+  case KeyActionOp_ExecBackground:
+  {
+    String command             = StrTrimSpaces(rest);
+    ok                         = !StrIsEmpty(command);
+    action->arg.command.offset = ok ? (u32)(command.data - line.data) : 0;
+    action->arg.command.size   = (u32)command.size;
+    rest                       = (String){0};
+    break;
+  }
+  case KeyActionOp_SwitchToWorkspace:
+  case KeyActionOp_MoveFocusedWindowToWorkspace:
+    ok = U16FromToken(ConfigNextToken(&rest), &action->arg.workspace);
+    break;
+  case KeyActionOp_KillFocusedWindow:
+  case KeyActionOp_RestartWindowManager:
+  case KeyActionOp_ExitWindowManager:
+    ok = true;
+    break;
+  default:
+    break;
+  }
+  // Trailing arguments are as much a mistake as missing ones
+  return ok && StrIsEmpty(StrTrimSpaces(rest));
+}
+
+internal String KeyBindingCommand(const Config *config, const KeyBinding *binding)
+{
+  String line = config->keymap.data[binding->line];
+  return StrSubstr(line, binding->action.arg.command.offset,
+                   binding->action.arg.command.offset + binding->action.arg.command.size);
+}
+
+internal bool KeyActionEquals(const Config *config, const KeyBinding *a, const KeyBinding *b)
+{
+  bool res = a->action.op == b->action.op;
+  if (res)
+  {
+    switch (a->action.op)
+    {
+    case KeyActionOp_FocusWindow:
+      res = a->action.arg.direction == b->action.arg.direction;
+      break;
+    case KeyActionOp_MoveWindow:
+      res = a->action.arg.move.direction == b->action.arg.move.direction &&
+            a->action.arg.move.amount == b->action.arg.move.amount;
+      break;
+    case KeyActionOp_WindowSizeChange:
+      res = a->action.arg.resize.axis == b->action.arg.resize.axis &&
+            a->action.arg.resize.amount == b->action.arg.resize.amount;
+      break;
+    case KeyActionOp_Exec:
+    case KeyActionOp_ExecBackground:
+      res = StrEquals(KeyBindingCommand(config, a), KeyBindingCommand(config, b));
+      break;
+    case KeyActionOp_SwitchToWorkspace:
+    case KeyActionOp_MoveFocusedWindowToWorkspace:
+      res = a->action.arg.workspace == b->action.arg.workspace;
+      break;
+    default:
+      break;
+    }
+  }
+  return res;
+}
+
+/*
+Compiles the keymap lines into bindings, so key presses never touch strings. A repeated
+combination is reported, bound to another action it's a conflict and the first one wins.
+Returns false if any line can't be decoded.
+*/
+internal bool ConfigCompileKeymap(Allocator allocator, Config *config)
+{
+  bool       ok   = true;
+  BindingSet seen = BindingSet_Init(allocator, Max(config->keymap.size * 2, 1));
+  config->bindings = ArrayKeyBinding_Init(allocator, Max(config->keymap.size, 1));
+  for (u64 i = 0; i < config->keymap.size; i += 1)
+  {
+    String     line    = config->keymap.data[i];
+    String     rest    = line;
+    String     combo   = ConfigNextToken(&rest);
+    KeyBinding binding = {.line = (u32)i};
+    if (!KeyComboParse(combo, &binding.modifiers, &binding.keysym) ||
+        !KeyActionParse(line, rest, &binding.action))
+    {
+      Errorf("Config: invalid keymap entry '%.*s'", StrFmtVal(line));
+      ok = false;
+      continue;
+    }
+    u32 *existing = BindingSet_Find(&seen, BindingKey(&binding));
+    if (!existing)
+    {
+      BindingSet_Push(allocator, &seen, BindingKey(&binding), (u32)config->bindings.size);
+      ArrayKeyBinding_Push(allocator, &config->bindings, binding);
+    }
+    else
+    {
+      KeyBinding *first = &config->bindings.data[*existing];
+      if (KeyActionEquals(config, first, &binding))
+      {
+        Warnf("Config: %.*s is bound twice to the same action", StrFmtVal(combo));
+      }
+      else
+      {
+        Errorf("Config: %.*s is bound to both '%.*s' and '%.*s', keeping the first",
+               StrFmtVal(combo), StrFmtVal(config->keymap.data[first->line]), StrFmtVal(line));
+      }
+    }
+  }
+  BindingSet_Deinit(allocator, &seen);
+  return ok;
+}
+
+/*
+Binary image of a validated snapshot, it only holds offsets so it can be used from any mapping
+address. Laid out as the header, the compiled bindings, a ConfigCacheString per startup action
+and per keymap line, then the string bytes the entries point into.
+*/
+#define CONFIG_CACHE_MAGIC "WMCFG002"
+
+typedef struct
+{
+  u64 path_hash;
+  u64 source_mtime;
+  u64 source_size;
+  u64 source_hash;
+} ConfigCacheKey;
+
+typedef struct
+{
+  u8             magic[8];
+  ConfigCacheKey key;
+  // A build with different record layouts doesn't pick up stale caches
+  u32            style_size;
+  u32            binding_size;
+  u32            bindings_count;
+  u32            startup_actions_count;
+  u32            keymap_count;
+  u32            strings_size;
+  StyleConfig    style;
+} ConfigCacheHeader;
+
+typedef struct
+{
+  u32 offset;
+  u32 size;
+} ConfigCacheString;
+
+// FNV-1a
+internal u64 ConfigCacheHash(String s)
+{
+  u64 hash = 14695981039346656037ull;
+  for (u64 i = 0; i < s.size; i += 1)
+  {
+    hash ^= s.data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+internal ConfigCacheKey ConfigCacheKeyFromSource(Allocator allocator, String path, String src)
+{
+  ConfigCacheKey key = {0};
+  key.path_hash      = ConfigCacheHash(path);
+  key.source_mtime   = Fs_LastModifiedTime(allocator, path);
+  key.source_size    = src.size;
+  key.source_hash    = ConfigCacheHash(src);
+  return key;
+}
+
+/*
+Fills in the snapshot from the cache file if it was built from the same source, no parsing
+involved. The snapshot keeps the cache mapped. The key can be computed by anyone who can read
+the config, so only a cache file that nobody but this user could have written is used.
+*/
+internal bool ConfigLoadCache(Allocator allocator, Config *config, ConfigCacheKey key)
+{
+  bool         ok    = false;
+  FsMappedFile cache = {0};
+  if (g_config_cache_path)
+  {
+    cache = Fs_MapPrivateFileCstr(allocator, g_config_cache_path);
+  }
+  String       image = cache.content;
+  if (image.size >= sizeof(ConfigCacheHeader))
+  {
+    ConfigCacheHeader *header = (ConfigCacheHeader *)image.data;
+    u64  count       = (u64)header->startup_actions_count + header->keymap_count;
+    u64  image_size  = sizeof(ConfigCacheHeader) + header->bindings_count * sizeof(KeyBinding) +
+                      count * sizeof(ConfigCacheString) + header->strings_size;
+    bool magic_ok    = memcmp(header->magic, CONFIG_CACHE_MAGIC, sizeof header->magic) == 0;
+    bool key_matches = memcmp(&header->key, &key, sizeof key) == 0;
+    ok = magic_ok && key_matches && header->style_size == sizeof(StyleConfig) &&
+         header->binding_size == sizeof(KeyBinding) && image.size == image_size;
+    if (ok)
+    {
+      KeyBinding        *bindings = (KeyBinding *)(header + 1);
+      ConfigCacheString *entries  = (ConfigCacheString *)(bindings + header->bindings_count);
+      u8                *strings = (u8 *)(entries + count);
+      ArrayString        arrays[2];
+      u64                sizes[2] = {header->startup_actions_count, header->keymap_count};
+      for (u64 a = 0, entry = 0; ok && a < sizeof(arrays) / sizeof(arrays[0]); a += 1)
+      {
+        arrays[a] = ArrayString_Init(allocator, Max(sizes[a], 1));
+        for (u64 i = 0; ok && i < sizes[a]; i += 1, entry += 1)
+        {
+          ConfigCacheString e = entries[entry];
+          ok = (u64)e.offset + e.size <= header->strings_size;
+          if (ok)
+          {
+            ArrayString_Push(allocator, &arrays[a], Str(strings + e.offset, e.size));
+          }
+        }
+      }
+      for (u64 i = 0; ok && i < header->bindings_count; i += 1)
+      {
+        ok = bindings[i].line < header->keymap_count;
+      }
+      if (ok)
+      {
+        config->cache           = cache;
+        config->style           = header->style;
+        config->startup_actions = arrays[0];
+        config->keymap          = arrays[1];
+        // Bindings are used in place, the snapshot never modifies them
+        config->bindings = (ArrayKeyBinding){.data     = bindings,
+                                             .size     = header->bindings_count,
+                                             .capacity = header->bindings_count};
+      }
+    }
+  }
+  if (!ok)
+  {
+    Fs_UnmapFile(allocator, &cache);
+  }
+  return ok;
+}
+
+/*
+Written to a temporary file and renamed over the cache, snapshots still mapping the previous
+cache keep their pages
+*/
+internal void ConfigWriteCache(Allocator allocator, const Config *config, ConfigCacheKey key)
+{
+  const ArrayString *arrays[2]    = {&config->startup_actions, &config->keymap};
+  u64                count        = config->startup_actions.size + config->keymap.size;
+  u64                strings_size = 0;
+  for (u64 a = 0; a < sizeof(arrays) / sizeof(arrays[0]); a += 1)
+  {
+    for (u64 i = 0; i < arrays[a]->size; i += 1)
+    {
+      strings_size += arrays[a]->data[i].size;
+    }
+  }
+  u64 bindings_size = config->bindings.size * sizeof(KeyBinding);
+  u64 size          = sizeof(ConfigCacheHeader) + bindings_size +
+                      count * sizeof(ConfigCacheString) + strings_size;
+  u8 *image         = Alloc(u8, size);
+  if (image && strings_size <= UINT32_MAX)
+  {
+    ConfigCacheHeader *header = (ConfigCacheHeader *)image;
+    memcpy(header->magic, CONFIG_CACHE_MAGIC, sizeof header->magic);
+    header->key                   = key;
+    header->style_size            = sizeof(StyleConfig);
+    header->binding_size          = sizeof(KeyBinding);
+    header->bindings_count        = (u32)config->bindings.size;
+    header->startup_actions_count = (u32)config->startup_actions.size;
+    header->keymap_count          = (u32)config->keymap.size;
+    header->strings_size          = (u32)strings_size;
+    header->style                 = config->style;
+
+    KeyBinding        *bindings = (KeyBinding *)(header + 1);
+    ConfigCacheString *entries  = (ConfigCacheString *)(bindings + config->bindings.size);
+    u8                *strings  = (u8 *)(entries + count);
+    u32                offset   = 0;
+    memcpy(bindings, config->bindings.data, bindings_size);
+    for (u64 a = 0, entry = 0; a < sizeof(arrays) / sizeof(arrays[0]); a += 1)
     {
+      for (u64 i = 0; i < arrays[a]->size; i += 1, entry += 1)
+      {
+        String s       = arrays[a]->data[i];
+        entries[entry] = (ConfigCacheString){.offset = offset, .size = (u32)s.size};
+        memcpy(strings + offset, s.data, s.size);
+        offset += (u32)s.size;
+      }
+    }
+
+    if (Fs_ReplaceFileCstr(g_config_cache_path, (char *)image, size) != FsErrors_None)
+    {
+      Errorf("Config: failed to write the cache at %s", g_config_cache_path);
+    }
+  }
+}
+
+/*
+Validates the parsed file and fills in the snapshot, strings it keeps are copied into the
+allocator so the source can go away
+*/
+internal bool ConfigParse(Allocator allocator, Config *config, String path, String src)
+{
+  IniMap config_map = Ini_LoadMapFromString(allocator, src);
+  // ArrayPair_StringToIniSection sections   = IniMap_KeyValuePairs(allocator, config_map);
+  // Debugf("config sections: %zu", sections.size);
+  // for (u64 i = 0; i < sections.size; i += 1)
+  // {
+  //   Debugf("%zuth: %.*s", i, StrFmtVal(sections.data[i].key));
+  // }
+  bool        valid         = true;
+  IniSection *style_section = IniMap_Find(&config_map, StrLit("style"));
+  if (style_section == NULL || style_section->tag != IniSection_Map)
+  {
+    valid = false;
+    Errorf("Config: style section was not found in the config file at %.*s", StrFmtVal(path));
+  }
+  IniSection *startup_actions_section = IniMap_Find(&config_map, StrLit("startup_actions"));
+  if (startup_actions_section == NULL || startup_actions_section->tag != IniSection_Array)
+  {
+    valid = false;
+    Errorf("Config: startup_actions section was not found in the config file at %.*s",
+           StrFmtVal(path));
+  }
+  IniSection *keymap_section = IniMap_Find(&config_map, StrLit("keymap"));
+  if (keymap_section == NULL || keymap_section->tag != IniSection_Array)
+  {
+    valid = false;
+    Errorf("Config: keymap section was not found in the config file at %.*s", StrFmtVal(path));
+  }
+  if (valid)
+  {
 
 #define PopulateField(field_name, type, section)                                                   \
   do                                                                                               \
@@ -62,92 +737,220 @@ internal bool LoadConfig(Allocator allocator, Config *config)
     }                                                                                              \
   } while (0)
 
-      PopulateField(minimum_width_tiling_window, u64, style_section);
-      PopulateField(default_width_percent_available_width, f64, style_section);
-      PopulateField(border_width, u64, style_section);
-      PopulateField(inner_gap, u64, style_section);
-      PopulateField(outer_gap_horizontal, u64, style_section);
-      PopulateField(outer_gap_vertical, u64, style_section);
+    PopulateField(minimum_width_tiling_window, u64, style_section);
+    PopulateField(default_width_percent_available_width, f64, style_section);
+    PopulateField(border_width, u64, style_section);
+    PopulateField(inner_gap, u64, style_section);
+    PopulateField(outer_gap_horizontal, u64, style_section);
+    PopulateField(outer_gap_vertical, u64, style_section);
 
-      if (valid)
+    if (valid)
+    {
+      IniValueMap map       = style_section->data.map;
+      IniValue   *ini_value = IniValueMap_Find(&map, StrLit("border_default_color"));
+      if (ini_value != NULL && ini_value->tag == IniValue_String)
       {
-        IniValueMap map       = style_section->data.map;
-        IniValue   *ini_value = IniValueMap_Find(&map, StrLit("border_default_color"));
-        if (ini_value != NULL && ini_value->tag == IniValue_String)
+        u8     dest[3];
+        String hex_str = ini_value->data.value_String;
+        if (hex_str.size < 2 || hex_str.data[0] != '#')
         {
-          u8     dest[3];
-          String hex_str = ini_value->data.value_String;
-          if (hex_str.size < 2 || hex_str.data[0] != '#')
-          {
-            valid = false;
-          }
-          else
-          {
-            String hex = StrSubstrFrom(hex_str, 1);
-            valid      = HexDecode(hex.data, hex.size, dest, sizeof dest);
-          }
-          if (valid)
-          {
-            config->style.border_default_color = (Vec3){dest[0], dest[1], dest[2]};
-          }
-          else
-          {
-            Error("Config: Failed to populate border_default_color - invalid hex data");
-          }
+          valid = false;
         }
         else
         {
-          Error("Config: Failed to populate border_default_color - incorrect or not present data");
-          valid = false;
+          String hex = StrSubstrFrom(hex_str, 1);
+          valid      = HexDecode(hex.data, hex.size, dest, sizeof dest);
+        }
+        if (valid)
+        {
+          config->style.border_default_color = (Vec3){dest[0], dest[1], dest[2]};
+        }
+        else
+        {
+          Error("Config: Failed to populate border_default_color - invalid hex data");
         }
       }
+      else
+      {
+        Error("Config: Failed to populate border_default_color - incorrect or not present data");
+        valid = false;
+      }
+    }
 
-      if (valid)
+    if (valid)
+    {
+      IniValueMap map       = style_section->data.map;
+      IniValue   *ini_value = IniValueMap_Find(&map, StrLit("border_active_color"));
+      if (ini_value != NULL && ini_value->tag == IniValue_String)
       {
-        IniValueMap map       = style_section->data.map;
-        IniValue   *ini_value = IniValueMap_Find(&map, StrLit("border_active_color"));
-        if (ini_value != NULL && ini_value->tag == IniValue_String)
+        u8     dest[3];
+        String hex_str = ini_value->data.value_String;
+        if (hex_str.size < 2 || hex_str.data[0] != '#')
         {
-          u8     dest[3];
-          String hex_str = ini_value->data.value_String;
-          if (hex_str.size < 2 || hex_str.data[0] != '#')
-          {
-            valid = false;
-          }
-          else
-          {
-            String hex = StrSubstrFrom(hex_str, 1);
-            valid      = HexDecode(hex.data, hex.size, dest, sizeof dest);
-          }
-          if (valid)
-          {
-            config->style.border_active_color = (Vec3){dest[0], dest[1], dest[2]};
-          }
-          else
-          {
-            Error("Config: Failed to populate border_active_color - invalid hex data");
-          }
+          valid = false;
         }
         else
         {
-          Error("Config: Failed to populate border_active_color - incorrect or not present data");
-          valid = false;
+          String hex = StrSubstrFrom(hex_str, 1);
+          valid      = HexDecode(hex.data, hex.size, dest, sizeof dest);
+        }
+        if (valid)
+        {
+          config->style.border_active_color = (Vec3){dest[0], dest[1], dest[2]};
         }
+        else
+        {
+          Error("Config: Failed to populate border_active_color - invalid hex data");
+        }
+      }
+      else
+      {
+        Error("Config: Failed to populate border_active_color - incorrect or not present data");
+        valid = false;
       }
+    }
 
-      if (valid)
+    if (valid)
+    {
+      IniValueMap map       = style_section->data.map;
+      IniValue   *ini_value = IniValueMap_Find(&map, StrLit("layout"));
+      if (ini_value == NULL ||
+          (ini_value->tag == IniValue_String && StrEquals(ini_value->data.value_String,
+                                                          StrLit("columns"))))
+      {
+        config->style.layout = LayoutKind_Columns;
+      }
+      else if (ini_value->tag == IniValue_String &&
+               StrEquals(ini_value->data.value_String, StrLit("bsp")))
       {
-        config->startup_actions = startup_actions_section->data.array;
-        config->keymap          = keymap_section->data.array;
+        config->style.layout = LayoutKind_Bsp;
       }
+      else
+      {
+        Error("Config: Failed to populate layout - expected columns or bsp");
+        valid = false;
+      }
+    }
+
+    if (valid)
+    {
+      config->startup_actions = startup_actions_section->data.array;
+      config->keymap          = keymap_section->data.array;
+      for (u64 i = 0; i < config->startup_actions.size; i += 1)
+      {
+        config->startup_actions.data[i] = StrClone(allocator, config->startup_actions.data[i]);
+      }
+      for (u64 i = 0; i < config->keymap.size; i += 1)
+      {
+        config->keymap.data[i] = StrClone(allocator, config->keymap.data[i]);
+      }
+      valid = ConfigCompileKeymap(allocator, config);
+    }
 
 #undef PopulateField
+  }
+  IniMap_Deinit(allocator,&config_map);
+  return valid;
+}
+
+internal Config *LoadConfig()
+{
+  ProfileZone("LoadConfig");
+  TraceBegin("LoadConfig");
+  u64       start     = TimeNow();
+  String    path      = g_config_path;
+  Arena    *arena     = ArenaInit(Megabytes(64));
+  Allocator allocator = ArenaAllocator(arena);
+  Config   *config    = (Config *)ArenaAlloc(arena, sizeof(Config));
+  config->arena       = arena;
+  Debug("Loading updated config from disk");
+  // A config file is small enough to be read rather than mapped, an editor truncating it while
+  // this runs leaves a short read instead of a SIGBUS. The few strings the snapshot keeps are
+  // copied.
+  FsMappedFile   source = Fs_MapFile(allocator, path);
+  ConfigCacheKey key    = ConfigCacheKeyFromSource(allocator, path, source.content);
+  bool           cached = ConfigLoadCache(allocator, config, key);
+  bool           valid  = cached;
+  if (!cached)
+  {
+    valid = ConfigParse(allocator, config, path, source.content);
+    if (valid && g_config_cache_path)
+    {
+      ConfigWriteCache(allocator, config, key);
+    }
+  }
+  Fs_UnmapFile(allocator, &source);
+  JournalPush((JournalRecord){.start    = start,
+                             .duration = JournalSince(start),
+                             .kind     = JournalKind_Action,
+                             .code     = JournalAction_ConfigReload,
+                             .arg0     = valid,
+                             .arg1     = cached});
+  if (valid)
+  {
+    Infof("Config: %s in %llu us", cached ? "loaded from the cache" : "parsed",
+          (unsigned long long)((TimeNow() - start) / Microsecons(1)));
+  }
+  // All or nothing, a partially valid file leaves nothing behind
+  if (!valid)
+  {
+    ArenaDeinit(arena);
+    config = NULL;
+  }
+  TraceEnd();
+  return config;
+}
+
+internal ConfigDiff ConfigDiffCompute(Allocator allocator, const Config *old, const Config *new)
+{
+  ConfigDiff res       = {0};
+  res.bindings_added   = ArrayKeyBinding_Init(allocator, Max(new->bindings.size, 1));
+  res.bindings_removed = ArrayKeyBinding_Init(allocator, old ? Max(old->bindings.size, 1) : 1);
+  if (!old)
+  {
+    res.relayout        = true;
+    res.border_width    = true;
+    res.border_colors   = true;
+    res.startup_actions = true;
+    BindingSetDifference(allocator, new->bindings, NULL, &res.bindings_added);
+  }
+  else
+  {
+    const StyleConfig *a = &old->style;
+    const StyleConfig *b = &new->style;
+    res.border_width     = a->border_width != b->border_width;
+    bool default_color   = memcmp(&a->border_default_color, &b->border_default_color, sizeof(Vec3));
+    bool active_color    = memcmp(&a->border_active_color, &b->border_active_color, sizeof(Vec3));
+    res.border_colors    = default_color || active_color;
+    res.relayout = res.border_width || a->inner_gap != b->inner_gap ||
+                   a->outer_gap_horizontal != b->outer_gap_horizontal ||
+                   a->outer_gap_vertical != b->outer_gap_vertical ||
+                   a->minimum_width_tiling_window != b->minimum_width_tiling_window ||
+                   a->default_width_percent_available_width !=
+                       b->default_width_percent_available_width ||
+                   a->layout != b->layout;
 
-      updated = true;
+    res.startup_actions = old->startup_actions.size != new->startup_actions.size;
+    for (u64 i = 0; !res.startup_actions && i < new->startup_actions.size; i += 1)
+    {
+      res.startup_actions = !StrEquals(old->startup_actions.data[i], new->startup_actions.data[i]);
     }
-    IniMap_Deinit(allocator,&config_map);
+
+    BindingSet old_set = BindingSetFromBindings(allocator, old->bindings);
+    BindingSet new_set = BindingSetFromBindings(allocator, new->bindings);
+    BindingSetDifference(allocator, new->bindings, &old_set, &res.bindings_added);
+    BindingSetDifference(allocator, old->bindings, &new_set, &res.bindings_removed);
+    BindingSet_Deinit(allocator, &old_set);
+    BindingSet_Deinit(allocator, &new_set);
   }
-  return updated;
+  return res;
+}
+
+internal bool ConfigDiffIsEmpty(const ConfigDiff *diff)
+{
+  return !diff->relayout && !diff->border_width && !diff->border_colors &&
+         !diff->startup_actions && diff->bindings_added.size == 0 &&
+         diff->bindings_removed.size == 0;
 }
 
 internal void PrintConfig(Allocator allocator, const Config* config)
@@ -191,6 +994,16 @@ internal void PrintConfig(Allocator allocator, const Config* config)
     PushLit("\n");
     PushLit("\touter_gap_vertical: ");
     PushU64(config->style.outer_gap_vertical);
+    PushLit("\n");
+    PushLit("\tlayout: ");
+    if (config->style.layout == LayoutKind_Bsp)
+    {
+      PushLit("bsp");
+    }
+    else
+    {
+      PushLit("columns");
+    }
     PushLit("\n}\n");
 
     PushLit("startup_actions\n");
@@ -3,29 +3,173 @@
 
 #include "../core/core.h"
 
+typedef enum : u8
+{
+  // Columns sharing the width, a scrolling strip once they overflow it
+  LayoutKind_Columns = 0,
+  LayoutKind_Bsp     = 1,
+} LayoutKind;
+
 typedef struct
 {
-  u64  minimum_width_tiling_window;
-  f64  default_width_percent_available_width;
-  u64  border_width;
-  Vec3 border_default_color;
-  Vec3 border_active_color;
-  u64  inner_gap;
-  u64  outer_gap_horizontal;
-  u64  outer_gap_vertical;
+  u64        minimum_width_tiling_window;
+  f64        default_width_percent_available_width;
+  u64        border_width;
+  Vec3       border_default_color;
+  Vec3       border_active_color;
+  u64        inner_gap;
+  u64        outer_gap_horizontal;
+  u64        outer_gap_vertical;
+  // Optional, columns when left out
+  LayoutKind layout;
 } StyleConfig;
 
+typedef enum : u8
+{
+  KeyActionOp_None                         = 0,
+  KeyActionOp_FocusWindow                  = 1,
+  KeyActionOp_MoveWindow                   = 2,
+  KeyActionOp_WindowSizeChange             = 3,
+  KeyActionOp_Exec                         = 4,
+  KeyActionOp_ExecBackground               = 5,
+  KeyActionOp_KillFocusedWindow            = 6,
+  KeyActionOp_RestartWindowManager         = 7,
+  KeyActionOp_ExitWindowManager            = 8,
+  KeyActionOp_SwitchToWorkspace            = 9,
+  KeyActionOp_MoveFocusedWindowToWorkspace = 10,
+  KeyActionOp_Count,
+} KeyActionOp;
+
+typedef enum : u8
+{
+  Direction_Left  = 0,
+  Direction_Right = 1,
+  Direction_Up    = 2,
+  Direction_Down  = 3,
+} Direction;
+
+typedef enum : u8
+{
+  Axis_Horizontal = 0,
+  Axis_Vertical   = 1,
+} Axis;
+
+/*
+Decoded action, the argument matching op is set. Exec commands are kept as a span of the
+keymap line the binding came from so the record holds no pointers.
+*/
+typedef struct
+{
+  KeyActionOp op;
+  union
+  {
+    Direction direction;
+    struct
+    {
+      Direction direction;
+      u16       amount;
+    } move;
+    struct
+    {
+      Axis axis;
+      u16  amount;
+    } resize;
+    struct
+    {
+      u32 offset;
+      u32 size;
+    } command;
+    u16 workspace;
+  } arg;
+} KeyAction;
+
+typedef struct
+{
+  u32       keysym;
+  // X modifier mask, only Shift, Control, Mod1 and Mod4 are used
+  u16       modifiers;
+  // Index into Config.keymap
+  u32       line;
+  KeyAction action;
+} KeyBinding;
+
+ArrayTemplate(KeyBinding);
+
+/*
+Immutable snapshot, everything it references lives in its arena
+*/
 typedef struct
 {
-  StyleConfig style;
-  ArrayString startup_actions;
-  ArrayString keymap;
+  Arena          *arena;
+  // Cached snapshots reference their strings straight out of the mapped cache file
+  FsMappedFile    cache;
+  StyleConfig     style;
+  ArrayString     startup_actions;
+  ArrayString     keymap;
+  // Compiled from keymap at load, one per distinct key combination
+  ArrayKeyBinding bindings;
 } Config;
 
 /*
-Returns true if the config parameter passed to it was updated
+Parses config.ini into a fresh snapshot. Returns NULL, leaving nothing behind, if the file is
+missing or any part of it is invalid.
+*/
+internal Config *LoadConfig();
+internal void    ConfigFree(Config *config);
+
+/*
+Resolves the config path, starts watching it through inotify and starts the loader thread.
+The returned descriptor belongs to the main loop's wait set, it is -1 if the file can't be
+watched and the config is then only loaded at startup.
+*/
+internal int  ConfigInit(Allocator allocator);
+internal void ConfigDeinit();
+/*
+Drains file change notifications, returns true once changes settled for the debounce interval
+so a burst of writes results in a single reload
+*/
+internal bool ConfigReloadDue(u64 now);
+/*
+Hands parsing over to the loader thread, the event thread never waits for file I/O
+*/
+internal void    ConfigRequestReload();
+/*
+Returns the newest successfully parsed snapshot, or NULL if none arrived since the last call.
+The caller owns it and frees the snapshot it replaces.
+*/
+internal Config *ConfigTakeReloaded();
+
+/*
+What changed between two snapshots, so a reload only sends the X requests it has to.
+Bindings are compared by key combination, rebinding a combination to another action
+needs no regrab.
+*/
+typedef struct
+{
+  // Gaps, widths or the border width changed, tiled geometry has to be recomputed
+  bool            relayout;
+  bool            border_width;
+  bool            border_colors;
+  bool            startup_actions;
+  ArrayKeyBinding bindings_added;
+  ArrayKeyBinding bindings_removed;
+} ConfigDiff;
+
+/*
+Diffs the new snapshot against the old one, a NULL old snapshot reports everything as changed
+*/
+internal ConfigDiff ConfigDiffCompute(Allocator allocator, const Config *old, const Config *new);
+internal bool       ConfigDiffIsEmpty(const ConfigDiff *diff);
+/*
+Returns the command of an exec or exec_background binding
+*/
+internal String      KeyBindingCommand(const Config *config, const KeyBinding *binding);
+internal const char *KeyActionOpName(KeyActionOp op);
+/*
+Decodes an action like "exec_background alacritty", the command span is stored relative to line.
+Keymap lines pass the text after the key combination, startup actions the whole line.
 */
-internal bool LoadConfig(Allocator allocator, Config *config);
+internal bool        KeyActionParse(String line, String text, KeyAction *action);
 
 internal void PrintConfig(Allocator allocator, const Config* config);
 
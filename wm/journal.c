@@ -0,0 +1,157 @@
+#include "journal.h"
+#include <stddef.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef struct
+{
+  JournalHeader *header;
+  JournalRecord *records;
+  u64            size;
+} Journal;
+
+Journal g_journal;
+
+internal bool JournalInit(char *path, u32 capacity)
+{
+  Assert(capacity > 0);
+  bool ok   = true;
+  u64  size = sizeof(JournalHeader) + sizeof(JournalRecord) * (u64)capacity;
+  // Always a new file, whatever the path names now, a symlink included, is never written through
+  unlink(path);
+  int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+  if (fd == -1)
+  {
+    Errorf("Journal: failed to open %s", path);
+    ok = false;
+  }
+  else
+  {
+    void *mapped = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0)
+    {
+      mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    // The mapping keeps the file referenced
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+      Errorf("Journal: failed to map %s", path);
+      ok = false;
+    }
+    else
+    {
+      g_journal.size                = size;
+      g_journal.header              = (JournalHeader *)mapped;
+      g_journal.records             = (JournalRecord *)(g_journal.header + 1);
+      g_journal.header->record_size = sizeof(JournalRecord);
+      g_journal.header->capacity    = capacity;
+      g_journal.header->head        = 0;
+      g_journal.header->start_time  = TimeNow();
+      memcpy(g_journal.header->magic, JOURNAL_MAGIC, sizeof g_journal.header->magic);
+    }
+  }
+  return ok;
+}
+
+internal void JournalDeinit()
+{
+  if (g_journal.header)
+  {
+    munmap(g_journal.header, g_journal.size);
+    g_journal = (Journal){0};
+  }
+}
+
+internal void JournalPush(JournalRecord record)
+{
+  if (g_journal.header)
+  {
+    // The config loader thread pushes too, so slots are claimed atomically
+    u64            head = __atomic_fetch_add(&g_journal.header->head, 1, __ATOMIC_ACQ_REL);
+    JournalRecord *slot = &g_journal.records[head % g_journal.header->capacity];
+    // Withdrawn before the body changes, published once all of it is in place
+    __atomic_store_n(&slot->commit, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(slot, &record, offsetof(JournalRecord, commit));
+    __atomic_store_n(&slot->commit, head + 1, __ATOMIC_RELEASE);
+  }
+}
+
+internal u32 JournalSince(u64 start)
+{
+  u64 duration = TimeNow() - start;
+  return (u32)Min(duration, (u64)UINT32_MAX);
+}
+
+internal const char *JournalKindName(u16 kind)
+{
+  static const char *names[JournalKind_Count] = {
+      [JournalKind_XEvent] = "event",   [JournalKind_XError] = "error",
+      [JournalKind_Request] = "request", [JournalKind_Action] = "action",
+      [JournalKind_Layout] = "layout",
+  };
+  return kind < JournalKind_Count ? names[kind] : "unknown";
+}
+
+internal const char *JournalCodeName(u16 kind, u16 code)
+{
+  // Core protocol event types and request opcodes, spelled out so the decoder doesn't need xcb
+  static const char *event_names[] = {
+      [2] = "KeyPress",          [3] = "KeyRelease",       [4] = "ButtonPress",
+      [5] = "ButtonRelease",     [6] = "MotionNotify",     [7] = "EnterNotify",
+      [8] = "LeaveNotify",       [9] = "FocusIn",          [10] = "FocusOut",
+      [11] = "KeymapNotify",     [12] = "Expose",          [13] = "GraphicsExposure",
+      [14] = "NoExposure",       [15] = "VisibilityNotify", [16] = "CreateNotify",
+      [17] = "DestroyNotify",    [18] = "UnmapNotify",     [19] = "MapNotify",
+      [20] = "MapRequest",       [21] = "ReparentNotify",  [22] = "ConfigureNotify",
+      [23] = "ConfigureRequest", [24] = "GravityNotify",   [25] = "ResizeRequest",
+      [26] = "CirculateNotify",  [27] = "CirculateRequest", [28] = "PropertyNotify",
+      [29] = "SelectionClear",   [30] = "SelectionRequest", [31] = "SelectionNotify",
+      [32] = "ColormapNotify",   [33] = "ClientMessage",   [34] = "MappingNotify",
+      [35] = "GenericEvent",
+  };
+  static const char *request_names[] = {
+      [2] = "ChangeWindowAttributes", [8] = "MapWindow",    [10] = "UnmapWindow",
+      [12] = "ConfigureWindow",       [18] = "ChangeProperty", [33] = "GrabKey",
+      [34] = "UngrabKey",             [42] = "SetInputFocus",  [43] = "GetInputFocus",
+  };
+  // LayoutKind, see wm/config.h
+  static const char *layout_names[] = {"columns", "bsp"};
+  static const char *action_names[JournalAction_Count] = {
+      [JournalAction_ConfigReload] = "config_reload",
+      [JournalAction_ManageWindow] = "manage_window",
+      [JournalAction_Spawn]        = "spawn",
+      [JournalAction_ChildExit]    = "child_exit",
+  };
+  const char *res = NULL;
+  switch (kind)
+  {
+  case JournalKind_XEvent:
+    if (code < sizeof event_names / sizeof event_names[0])
+    {
+      res = event_names[code];
+    }
+    break;
+  case JournalKind_Request:
+    if (code < sizeof request_names / sizeof request_names[0])
+    {
+      res = request_names[code];
+    }
+    break;
+  case JournalKind_Action:
+    if (code < JournalAction_Count)
+    {
+      res = action_names[code];
+    }
+    break;
+  case JournalKind_Layout:
+    if (code < sizeof layout_names / sizeof layout_names[0])
+    {
+      res = layout_names[code];
+    }
+    break;
+  }
+  return res ? res : "";
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef WM_JOURNAL_H
+#define WM_JOURNAL_H
+
+#include "../core/core.h"
+
+typedef enum : u16
+{
+  JournalKind_XEvent  = 0,
+  JournalKind_XError  = 1,
+  JournalKind_Request = 2,
+  JournalKind_Action  = 3,
+  JournalKind_Layout  = 4,
+  JournalKind_Count,
+} JournalKind;
+
+typedef enum : u16
+{
+  JournalAction_ConfigReload = 0,
+  JournalAction_ManageWindow = 1,
+  JournalAction_Spawn        = 2,
+  JournalAction_ChildExit    = 3,
+  JournalAction_Count,
+} JournalAction;
+
+/*
+Fixed-size record, code is the X event type, X error code, request major opcode, JournalAction
+or LayoutKind depending on the record kind.
+Layout records are one workspace's pass: arg0 is the monitor << 16 | workspace, arg1 the windows
+whose geometry was computed and arg2 the ConfigureWindow requests sent for them. The duration
+covers computing the geometry.
+*/
+typedef struct
+{
+  u64 start;
+  // Nanoseconds, saturated, 0 for instant records
+  u32 duration;
+  u16 kind;
+  u16 code;
+  u32 window;
+  u32 sequence;
+  u32 arg0;
+  u32 arg1;
+  u32 arg2;
+  u32 pad;
+  // Index + 1 of the record in the slot, stored last: a slot whose commit doesn't match the
+  // index being read is stale or was being written when it was read
+  u64 commit;
+} JournalRecord;
+
+#define JOURNAL_MAGIC "WMJRNL02"
+
+typedef struct
+{
+  u8  magic[8];
+  u32 record_size;
+  u32 capacity;
+  // Records ever claimed, the next one goes to records[head % capacity]. Claimed records are
+  // only complete once their commit is set.
+  u64 head;
+  u64 start_time;
+  u8  pad[32];
+} JournalHeader;
+
+/*
+Maps a ring of capacity records backed by the file at path. The journal survives crashes and
+is read back with the `journal` decoder program, writes are no-ops if Init failed. The file is
+replaced by a new one only the user can read, Init fails if something else takes the name first.
+*/
+internal bool JournalInit(char *path, u32 capacity);
+internal void JournalDeinit();
+internal void JournalPush(JournalRecord record);
+/*
+Returns the nanoseconds elapsed since start, saturated to fit JournalRecord.duration
+*/
+internal u32  JournalSince(u64 start);
+
+internal const char *JournalKindName(u16 kind);
+internal const char *JournalCodeName(u16 kind, u16 code);
+
+#endif
\ No newline at end of file
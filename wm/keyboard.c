@@ -0,0 +1,508 @@
+#include "keyboard.h"
+
+#define KEYSYM_NUM_LOCK 0xff7f
+#define KEYSYM_SCROLL_LOCK 0xff14
+
+Keyboard g_keyboard;
+
+internal int KeysymKeycodeCompare(const void *lhs, const void *rhs)
+{
+  const KeysymKeycode *a   = lhs;
+  const KeysymKeycode *b   = rhs;
+  int                  res = (a->keysym > b->keysym) - (a->keysym < b->keysym);
+  if (res == 0)
+  {
+    res = (int)a->rank - (int)b->rank;
+  }
+  if (res == 0)
+  {
+    res = (int)a->keycode - (int)b->keycode;
+  }
+  return res;
+}
+
+internal xcb_keycode_t KeyboardKeycode(u32 keysym)
+{
+  xcb_keycode_t res = 0;
+  u32           lo  = 0;
+  u32           hi  = g_keyboard.keysyms_count;
+  while (lo < hi)
+  {
+    u32 mid = lo + (hi - lo) / 2;
+    if (g_keyboard.keysyms[mid].keysym < keysym)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  if (lo < g_keyboard.keysyms_count && g_keyboard.keysyms[lo].keysym == keysym)
+  {
+    res = g_keyboard.keysyms[lo].keycode;
+  }
+  return res;
+}
+
+internal u8 KeyboardGroup()
+{
+  return g_keyboard.group;
+}
+
+/*
+Local only, a group switch costs no round trip
+*/
+internal void KeyboardBuildKeysymTable()
+{
+  ProfileZone("KeyboardBuildKeysymTable");
+  g_keyboard.keysyms_count = 0;
+  for (u32 keycode = 0; keycode < 256; keycode += 1)
+  {
+    KeyboardKey *key = &g_keyboard.keys[keycode];
+    // Out of range groups wrap around, like XKB does by default
+    u32 active = key->groups != 0 ? g_keyboard.group % key->groups : 0;
+    for (u32 group = 0; group < key->groups; group += 1)
+    {
+      for (u32 level = 0; level < key->width; level += 1)
+      {
+        u32 keysym = key->keysyms[group][level];
+        if (keysym != XCB_NO_SYMBOL)
+        {
+          g_keyboard.keysyms[g_keyboard.keysyms_count] = (KeysymKeycode){
+              .keysym = keysym, .rank = group != active, .keycode = (xcb_keycode_t)keycode};
+          g_keyboard.keysyms_count += 1;
+        }
+      }
+    }
+  }
+  qsort(g_keyboard.keysyms, g_keyboard.keysyms_count, sizeof(KeysymKeycode),
+        KeysymKeycodeCompare);
+}
+
+internal void KeyboardLoadCoreMapping(xcb_get_keyboard_mapping_reply_t *reply,
+                                      xcb_keycode_t                     first_keycode)
+{
+  xcb_keysym_t *keysyms  = xcb_get_keyboard_mapping_keysyms(reply);
+  u32           count    = (u32)xcb_get_keyboard_mapping_keysyms_length(reply);
+  u32           per_code = reply->keysyms_per_keycode;
+  u32           width    = Min(per_code, KEYBOARD_MAX_LEVELS);
+  for (u32 i = 0; per_code != 0 && i < count / per_code; i += 1)
+  {
+    // Without XKB there is no group structure, every keysym of the key lands in the first one
+    KeyboardKey *key = &g_keyboard.keys[(u8)(first_keycode + i)];
+    *key             = (KeyboardKey){.groups = 1, .width = (u8)width};
+    for (u32 level = 0; level < width; level += 1)
+    {
+      key->keysyms[0][level] = keysyms[i * per_code + level];
+    }
+  }
+}
+
+internal void KeyboardLoadXkbMap(xcb_xkb_get_map_reply_t *reply)
+{
+  xcb_xkb_get_map_map_t map;
+  xcb_xkb_get_map_map_unpack(xcb_xkb_get_map_map(reply), reply->nTypes, reply->nKeySyms,
+                             reply->nKeyActions, reply->totalActions, reply->totalKeyBehaviors,
+                             reply->virtualMods, reply->totalKeyExplicit, reply->totalModMapKeys,
+                             reply->totalVModMapKeys, reply->present, &map);
+  xcb_xkb_key_sym_map_iterator_t iter = xcb_xkb_get_map_map_syms_rtrn_iterator(reply, &map);
+  for (u32 i = 0; i < reply->nKeySyms; i += 1)
+  {
+    xcb_xkb_key_sym_map_t *sym_map = iter.data;
+    xcb_keysym_t          *keysyms = xcb_xkb_key_sym_map_syms(sym_map);
+    u32                    count   = (u32)xcb_xkb_key_sym_map_syms_length(sym_map);
+    u32                    groups  = Min(sym_map->groupInfo & 0x0f, KEYBOARD_MAX_GROUPS);
+    u32                    width   = Min(sym_map->width, KEYBOARD_MAX_LEVELS);
+    KeyboardKey           *key     = &g_keyboard.keys[(u8)(reply->firstKeySym + i)];
+    *key                           = (KeyboardKey){.groups = (u8)groups, .width = (u8)width};
+    for (u32 group = 0; group < groups; group += 1)
+    {
+      for (u32 level = 0; level < width && group * sym_map->width + level < count; level += 1)
+      {
+        key->keysyms[group][level] = keysyms[group * sym_map->width + level];
+      }
+    }
+    xcb_xkb_key_sym_map_next(&iter);
+  }
+}
+
+/*
+Returns the modifier mask one of the keys producing the keysym is mapped to, 0 if none is
+*/
+internal u16 KeyboardModifierOfKeysym(xcb_get_modifier_mapping_reply_t *reply, u32 keysym)
+{
+  u16            res      = 0;
+  xcb_keycode_t *keycodes = xcb_get_modifier_mapping_keycodes(reply);
+  u32            per_mod  = reply->keycodes_per_modifier;
+  for (u32 modifier = 0; res == 0 && modifier < 8; modifier += 1)
+  {
+    for (u32 i = 0; res == 0 && i < per_mod; i += 1)
+    {
+      // Keycode 0 is never a valid key, its cached row stays empty
+      KeyboardKey *key = &g_keyboard.keys[keycodes[modifier * per_mod + i]];
+      for (u32 j = 0; j < KEYBOARD_MAX_GROUPS * KEYBOARD_MAX_LEVELS; j += 1)
+      {
+        if (key->keysyms[j / KEYBOARD_MAX_LEVELS][j % KEYBOARD_MAX_LEVELS] == keysym)
+        {
+          res = (u16)(1 << modifier);
+          break;
+        }
+      }
+    }
+  }
+  return res;
+}
+
+/*
+Returns true if the lock modifier variants changed
+*/
+internal bool KeyboardLoadModifiers(xcb_get_modifier_mapping_reply_t *reply)
+{
+  u16 mask = XCB_MOD_MASK_LOCK | KeyboardModifierOfKeysym(reply, KEYSYM_NUM_LOCK) |
+             KeyboardModifierOfKeysym(reply, KEYSYM_SCROLL_LOCK);
+  // Every subset of the lock mask, the empty one included
+  u16 variants[8];
+  u32 variants_count = 0;
+  for (u32 subset = mask;; subset = (subset - 1) & mask)
+  {
+    variants[variants_count] = (u16)subset;
+    variants_count += 1;
+    if (subset == 0 || variants_count == 8)
+    {
+      break;
+    }
+  }
+  bool changed = variants_count != g_keyboard.lock_variants_count ||
+                 memcmp(variants, g_keyboard.lock_variants, sizeof(u16) * variants_count) != 0;
+  memcpy(g_keyboard.lock_variants, variants, sizeof(u16) * variants_count);
+  g_keyboard.lock_variants_count = variants_count;
+  return changed;
+}
+
+/*
+Sends the requests for every part asked for before waiting for any reply. Returns true if the
+lock modifier variants changed.
+*/
+internal bool KeyboardFetch(xcb_connection_t *conn, KeyboardPart parts,
+                            xcb_keycode_t first_keycode, u8 keycodes_count)
+{
+  ProfileZone("KeyboardFetch");
+  bool                              locks_changed   = false;
+  xcb_xkb_get_map_cookie_t          map_cookie      = {0};
+  xcb_get_keyboard_mapping_cookie_t core_cookie     = {0};
+  xcb_get_modifier_mapping_cookie_t modifier_cookie = {0};
+  xcb_xkb_get_state_cookie_t        state_cookie    = {0};
+  if ((parts & KeyboardPart_Keysyms) && g_keyboard.xkb)
+  {
+    map_cookie = xcb_xkb_get_map(conn, XCB_XKB_ID_USE_CORE_KBD, 0, XCB_XKB_MAP_PART_KEY_SYMS, 0,
+                                 0, first_keycode, keycodes_count, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                 0);
+    TraceFlowStart("XkbGetMap", map_cookie.sequence);
+  }
+  else if (parts & KeyboardPart_Keysyms)
+  {
+    core_cookie = xcb_get_keyboard_mapping(conn, first_keycode, keycodes_count);
+    TraceFlowStart("GetKeyboardMapping", core_cookie.sequence);
+  }
+  if (parts & KeyboardPart_Modifiers)
+  {
+    modifier_cookie = xcb_get_modifier_mapping(conn);
+    TraceFlowStart("GetModifierMapping", modifier_cookie.sequence);
+  }
+  if ((parts & KeyboardPart_Group) && g_keyboard.xkb)
+  {
+    state_cookie = xcb_xkb_get_state(conn, XCB_XKB_ID_USE_CORE_KBD);
+    TraceFlowStart("XkbGetState", state_cookie.sequence);
+  }
+
+  if (map_cookie.sequence != 0)
+  {
+    TraceBegin("xcb_xkb_get_map_reply");
+    xcb_xkb_get_map_reply_t *reply = xcb_xkb_get_map_reply(conn, map_cookie, NULL);
+    TraceFlowEnd("XkbGetMap", map_cookie.sequence);
+    TraceEnd();
+    if (reply)
+    {
+      KeyboardLoadXkbMap(reply);
+      free(reply);
+    }
+    else
+    {
+      Error("Keyboard: failed to get the XKB keymap");
+    }
+  }
+  if (core_cookie.sequence != 0)
+  {
+    TraceBegin("xcb_get_keyboard_mapping_reply");
+    xcb_get_keyboard_mapping_reply_t *reply =
+        xcb_get_keyboard_mapping_reply(conn, core_cookie, NULL);
+    TraceFlowEnd("GetKeyboardMapping", core_cookie.sequence);
+    TraceEnd();
+    if (reply)
+    {
+      KeyboardLoadCoreMapping(reply, first_keycode);
+      free(reply);
+    }
+    else
+    {
+      Error("Keyboard: failed to get the keyboard mapping");
+    }
+  }
+  if (modifier_cookie.sequence != 0)
+  {
+    TraceBegin("xcb_get_modifier_mapping_reply");
+    xcb_get_modifier_mapping_reply_t *reply =
+        xcb_get_modifier_mapping_reply(conn, modifier_cookie, NULL);
+    TraceFlowEnd("GetModifierMapping", modifier_cookie.sequence);
+    TraceEnd();
+    if (reply)
+    {
+      locks_changed = KeyboardLoadModifiers(reply);
+      free(reply);
+    }
+  }
+  if (state_cookie.sequence != 0)
+  {
+    TraceBegin("xcb_xkb_get_state_reply");
+    xcb_xkb_get_state_reply_t *reply = xcb_xkb_get_state_reply(conn, state_cookie, NULL);
+    TraceFlowEnd("XkbGetState", state_cookie.sequence);
+    TraceEnd();
+    if (reply)
+    {
+      g_keyboard.group = reply->group;
+      free(reply);
+    }
+  }
+  return locks_changed;
+}
+
+internal bool KeyboardInit(xcb_connection_t *conn, int *xkb_event_base)
+{
+  *xkb_event_base                        = -1;
+  const xcb_query_extension_reply_t *ext = xcb_get_extension_data(conn, &xcb_xkb_id);
+  if (ext && ext->present)
+  {
+    xcb_xkb_use_extension_cookie_t cookie =
+        xcb_xkb_use_extension(conn, XCB_XKB_MAJOR_VERSION, XCB_XKB_MINOR_VERSION);
+    TraceFlowStart("XkbUseExtension", cookie.sequence);
+    TraceBegin("xcb_xkb_use_extension_reply");
+    xcb_xkb_use_extension_reply_t *reply = xcb_xkb_use_extension_reply(conn, cookie, NULL);
+    TraceFlowEnd("XkbUseExtension", cookie.sequence);
+    TraceEnd();
+    g_keyboard.xkb = reply && reply->supported;
+    free(reply);
+  }
+  if (g_keyboard.xkb)
+  {
+    *xkb_event_base = ext->first_event;
+    // State notifies are narrowed to group changes, every modifier press would wake us otherwise
+    u16 events    = XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY | XCB_XKB_EVENT_TYPE_MAP_NOTIFY |
+                    XCB_XKB_EVENT_TYPE_STATE_NOTIFY;
+    u16 map_parts = XCB_XKB_MAP_PART_KEY_SYMS | XCB_XKB_MAP_PART_MODIFIER_MAP;
+    xcb_xkb_select_events_details_t details = {
+        .affectNewKeyboard  = XCB_XKB_NKN_DETAIL_KEYCODES,
+        .newKeyboardDetails = XCB_XKB_NKN_DETAIL_KEYCODES,
+        .affectState        = XCB_XKB_STATE_PART_GROUP_STATE,
+        .stateDetails       = XCB_XKB_STATE_PART_GROUP_STATE,
+    };
+    xcb_xkb_select_events_aux(conn, XCB_XKB_ID_USE_CORE_KBD, events, 0, 0, map_parts, map_parts,
+                              &details);
+  }
+  else
+  {
+    Warn("Keyboard: XKB is not available, layout groups are ignored");
+  }
+
+  g_keyboard.grabs_arena   = ArenaInit(Megabytes(16));
+  g_keyboard.grabs         = ArrayKeyGrab_Init(ArenaAllocator(g_keyboard.grabs_arena), 64);
+  const xcb_setup_t *setup = xcb_get_setup(conn);
+  KeyboardFetch(conn, KeyboardPart_Keysyms | KeyboardPart_Modifiers | KeyboardPart_Group,
+                setup->min_keycode, (u8)(setup->max_keycode - setup->min_keycode + 1));
+  KeyboardBuildKeysymTable();
+  return g_keyboard.keysyms_count != 0;
+}
+
+internal void KeyboardDeinit()
+{
+  if (g_keyboard.grabs_arena)
+  {
+    ArenaDeinit(g_keyboard.grabs_arena);
+  }
+  g_keyboard = (Keyboard){0};
+}
+
+internal u64 KeyboardSendGrabs(xcb_connection_t *conn, xcb_window_t root, KeyGrab grab,
+                              bool grab_key)
+{
+  u64 requests = 0;
+  if (grab.keycode != 0)
+  {
+    for (u32 i = 0; i < g_keyboard.lock_variants_count; i += 1)
+    {
+      u16 modifiers = grab.modifiers | g_keyboard.lock_variants[i];
+      if (grab_key)
+      {
+        xcb_grab_key(conn, 1, root, modifiers, grab.keycode, XCB_GRAB_MODE_ASYNC,
+                     XCB_GRAB_MODE_ASYNC);
+      }
+      else
+      {
+        xcb_ungrab_key(conn, grab.keycode, root, modifiers);
+      }
+      requests += 1;
+    }
+  }
+  return requests;
+}
+
+internal u64 KeyboardGrab(xcb_connection_t *conn, xcb_window_t root, u32 keysym, u16 modifiers)
+{
+  KeyGrab grab = {.keysym = keysym, .modifiers = modifiers, .keycode = KeyboardKeycode(keysym)};
+  ArrayKeyGrab_Push(ArenaAllocator(g_keyboard.grabs_arena), &g_keyboard.grabs, grab);
+  if (grab.keycode == 0)
+  {
+    Warnf("Keyboard: keysym 0x%x is not on the keyboard, grabbed once it is", keysym);
+  }
+  return KeyboardSendGrabs(conn, root, grab, true);
+}
+
+internal u64 KeyboardUngrab(xcb_connection_t *conn, xcb_window_t root, u32 keysym,
+                            u16 modifiers)
+{
+  u64 requests = 0;
+  for (u64 i = 0; i < g_keyboard.grabs.size; i += 1)
+  {
+    KeyGrab grab = g_keyboard.grabs.data[i];
+    if (grab.keysym == keysym && grab.modifiers == modifiers)
+    {
+      requests = KeyboardSendGrabs(conn, root, grab, false);
+      ArrayKeyGrab_UnorderedRemove(&g_keyboard.grabs, i);
+      break;
+    }
+  }
+  return requests;
+}
+
+internal void KeyboardSync(xcb_connection_t *conn)
+{
+  // Any reply comes after the errors of every request sent before it
+  xcb_get_input_focus_cookie_t cookie = xcb_get_input_focus(conn);
+  TraceFlowStart("GetInputFocus", cookie.sequence);
+  TraceBegin("xcb_get_input_focus_reply");
+  free(xcb_get_input_focus_reply(conn, cookie, NULL));
+  TraceFlowEnd("GetInputFocus", cookie.sequence);
+  TraceEnd();
+}
+
+/*
+Rebuilds the keysym table from the cache and moves the grabs whose keycode changed
+*/
+internal u64 KeyboardRegrab(xcb_connection_t *conn, xcb_window_t root, bool locks_changed,
+                            const char *reason, u64 start)
+{
+  u64 requests  = 0;
+  u64 regrabbed = 0;
+  KeyboardBuildKeysymTable();
+  if (locks_changed)
+  {
+    // Grabs were issued for the old lock variants, drop them all in one request
+    xcb_ungrab_key(conn, XCB_GRAB_ANY, root, XCB_MOD_MASK_ANY);
+    requests += 1;
+  }
+  for (u64 i = 0; i < g_keyboard.grabs.size; i += 1)
+  {
+    KeyGrab      *grab    = &g_keyboard.grabs.data[i];
+    xcb_keycode_t keycode = KeyboardKeycode(grab->keysym);
+    if (locks_changed || keycode != grab->keycode)
+    {
+      if (!locks_changed)
+      {
+        requests += KeyboardSendGrabs(conn, root, *grab, false);
+      }
+      grab->keycode = keycode;
+      requests += KeyboardSendGrabs(conn, root, *grab, true);
+      regrabbed += 1;
+    }
+  }
+  if (requests != 0)
+  {
+    KeyboardSync(conn);
+  }
+  u64 elapsed = (TimeNow() - start) / Microsecons(1);
+  Infof("Keyboard: %s, regrabbed %llu of %llu bindings with %llu requests in %llu us", reason,
+        (unsigned long long)regrabbed, (unsigned long long)g_keyboard.grabs.size,
+        (unsigned long long)requests, (unsigned long long)elapsed);
+  return requests;
+}
+
+internal u64 KeyboardHandleMappingNotify(xcb_connection_t *conn, xcb_window_t root,
+                                         xcb_mapping_notify_event_t *event)
+{
+  ProfileZone("KeyboardHandleMappingNotify");
+  u64 requests = 0;
+  // With XKB the same change also arrives as an XKB map notify, which is handled instead
+  if (!g_keyboard.xkb && event->request != XCB_MAPPING_POINTER)
+  {
+    u64          start = TimeNow();
+    KeyboardPart parts =
+        event->request == XCB_MAPPING_KEYBOARD ? KeyboardPart_Keysyms : KeyboardPart_Modifiers;
+    bool locks_changed = KeyboardFetch(conn, parts, event->first_keycode, event->count);
+    requests           = KeyboardRegrab(conn, root, locks_changed, "mapping changed", start);
+  }
+  return requests;
+}
+
+internal u64 KeyboardHandleXkbEvent(xcb_connection_t *conn, xcb_window_t root, XkbEvent *event)
+{
+  ProfileZone("KeyboardHandleXkbEvent");
+  u64 requests = 0;
+  u64 start    = TimeNow();
+  switch (event->any.xkbType)
+  {
+  case XCB_XKB_NEW_KEYBOARD_NOTIFY:
+  {
+    xcb_xkb_new_keyboard_notify_event_t *notify = &event->new_keyboard_notify;
+    if (notify->changed & XCB_XKB_NKN_DETAIL_KEYCODES)
+    {
+      memset(g_keyboard.keys, 0, sizeof g_keyboard.keys);
+      bool locks_changed =
+          KeyboardFetch(conn, KeyboardPart_Keysyms | KeyboardPart_Modifiers | KeyboardPart_Group,
+                        notify->minKeyCode, (u8)(notify->maxKeyCode - notify->minKeyCode + 1));
+      requests = KeyboardRegrab(conn, root, locks_changed, "keyboard replaced", start);
+    }
+    break;
+  }
+  case XCB_XKB_MAP_NOTIFY:
+  {
+    xcb_xkb_map_notify_event_t *notify = &event->map_notify;
+    KeyboardPart                parts  = 0;
+    if ((notify->changed & XCB_XKB_MAP_PART_KEY_SYMS) && notify->nKeySyms != 0)
+    {
+      parts |= KeyboardPart_Keysyms;
+    }
+    if (notify->changed & XCB_XKB_MAP_PART_MODIFIER_MAP)
+    {
+      parts |= KeyboardPart_Modifiers;
+    }
+    if (parts != 0)
+    {
+      // Only the keycodes named by the notify are fetched again
+      bool locks_changed = KeyboardFetch(conn, parts, notify->firstKeySym, notify->nKeySyms);
+      requests           = KeyboardRegrab(conn, root, locks_changed, "keymap changed", start);
+    }
+    break;
+  }
+  case XCB_XKB_STATE_NOTIFY:
+  {
+    xcb_xkb_state_notify_event_t *notify = &event->state_notify;
+    if ((notify->changed & XCB_XKB_STATE_PART_GROUP_STATE) && notify->group != g_keyboard.group)
+    {
+      g_keyboard.group = notify->group;
+      requests         = KeyboardRegrab(conn, root, false, "group changed", start);
+    }
+    break;
+  }
+  }
+  return requests;
+}
\ No newline at end of file
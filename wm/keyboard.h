@@ -0,0 +1,110 @@
+#ifndef WM_KEYBOARD_H
+#define WM_KEYBOARD_H
+
+#include "../core/core.h"
+#include "config.h"
+#include <xcb/xcb.h>
+#include <xcb/xproto.h>
+#include <xcb/xkb.h>
+
+// XKB allows at most 4 groups, deeper levels than 8 are dropped from the cache
+#define KEYBOARD_MAX_GROUPS 4
+#define KEYBOARD_MAX_LEVELS 8
+
+typedef struct
+{
+  u32           keysym;
+  // 0 when the keysym comes from the active group, lookups prefer it over the other groups
+  u8            rank;
+  xcb_keycode_t keycode;
+} KeysymKeycode;
+
+typedef struct
+{
+  u8  groups;
+  u8  width;
+  u32 keysyms[KEYBOARD_MAX_GROUPS][KEYBOARD_MAX_LEVELS];
+} KeyboardKey;
+
+typedef struct
+{
+  u32           keysym;
+  u16           modifiers;
+  // 0 while the keysym isn't on the keyboard, picked up again on the next mapping change
+  xcb_keycode_t keycode;
+} KeyGrab;
+
+ArrayTemplate(KeyGrab);
+
+typedef enum : u8
+{
+  KeyboardPart_Keysyms   = 1 << 0,
+  KeyboardPart_Modifiers = 1 << 1,
+  KeyboardPart_Group     = 1 << 2,
+} KeyboardPart;
+
+// Every XKB event shares one event code, xkbType tells them apart
+typedef union
+{
+  struct
+  {
+    u8              response_type;
+    u8              xkbType;
+    u16             sequence;
+    xcb_timestamp_t time;
+    u8              deviceID;
+  } any;
+  xcb_xkb_new_keyboard_notify_event_t new_keyboard_notify;
+  xcb_xkb_map_notify_event_t          map_notify;
+  xcb_xkb_state_notify_event_t        state_notify;
+} XkbEvent;
+
+typedef struct
+{
+  // False when the server has no XKB, the core mapping is cached instead and groups are ignored
+  bool          xkb;
+  u8            group;
+  // Cached keymap, XKB map notifies update only the keycodes they name
+  KeyboardKey   keys[256];
+  // Rebuilt from the cached keymap on every mapping or group change, sorted by keysym, rank,
+  // then keycode
+  KeysymKeycode keysyms[256 * KEYBOARD_MAX_GROUPS * KEYBOARD_MAX_LEVELS];
+  u32           keysyms_count;
+  // Every combination of the CapsLock, NumLock and ScrollLock masks, grabs are issued for each
+  u16           lock_variants[8];
+  u32           lock_variants_count;
+  Arena        *grabs_arena;
+  ArrayKeyGrab  grabs;
+} Keyboard;
+
+/*
+Negotiates XKB and subscribes to its map, state and new keyboard notifies, then fetches the
+keymap, the modifier mapping and the active group in one round trip. xkb_event_base is -1 if
+XKB isn't available.
+*/
+internal bool          KeyboardInit(xcb_connection_t *conn, int *xkb_event_base);
+internal void          KeyboardDeinit();
+/*
+Returns 0 if no key produces the keysym, keys of the active group win over the others
+*/
+internal xcb_keycode_t KeyboardKeycode(u32 keysym);
+internal u8            KeyboardGroup();
+
+/*
+Grab requests are unchecked and return the number of requests sent. Errors, like another
+client holding the grab, arrive as events, KeyboardSync waits for all of them at once.
+*/
+internal u64  KeyboardGrab(xcb_connection_t *conn, xcb_window_t root, u32 keysym, u16 modifiers);
+internal u64  KeyboardUngrab(xcb_connection_t *conn, xcb_window_t root, u32 keysym,
+                             u16 modifiers);
+internal void KeyboardSync(xcb_connection_t *conn);
+/*
+Both reload what changed and regrab only the bindings whose keycode moved, everything if the
+lock modifiers moved. They return the number of requests sent, 0 means the keycodes of every
+binding are unchanged.
+*/
+internal u64  KeyboardHandleMappingNotify(xcb_connection_t *conn, xcb_window_t root,
+                                          xcb_mapping_notify_event_t *event);
+internal u64  KeyboardHandleXkbEvent(xcb_connection_t *conn, xcb_window_t root, XkbEvent *event);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,262 @@
+#include "launcher.h"
+#include "journal.h"
+
+Launcher g_launcher;
+
+internal u64 LaunchMapHash(u32 pid, u64 max)
+{
+  return ((u64)pid * 11400714819323198485ull >> 32) % max;
+}
+
+internal bool LaunchMapKeyEquals(u32 lhs, u32 rhs)
+{
+  return lhs == rhs;
+}
+
+internal bool LaunchMapKeyIsEmpty(u32 pid)
+{
+  return pid == 0;
+}
+
+internal void LauncherInit()
+{
+  g_launcher.arena       = ArenaInit(Megabytes(16));
+  g_launcher.launches    = LaunchMap_Init(ArenaAllocator(g_launcher.arena), 64);
+  g_launcher.next_expiry = UINT64_MAX;
+}
+
+internal void LauncherDeinit()
+{
+  if (g_launcher.arena)
+  {
+    ArenaDeinit(g_launcher.arena);
+  }
+  g_launcher = (Launcher){0};
+}
+
+internal i32 LauncherSpawn(String command, u16 monitor, u16 workspace)
+{
+  ProfileZone("LauncherSpawn");
+  u64 start = TimeNow();
+  i32 pid   = Process_Spawn(command);
+  if (pid > 0)
+  {
+    LaunchRecord record = {.monitor = monitor, .workspace = workspace, .time = start};
+    LaunchMap_Push(ArenaAllocator(g_launcher.arena), &g_launcher.launches, (u32)pid, record);
+    g_launcher.next_expiry = Min(g_launcher.next_expiry, start + LAUNCH_RECORD_LIFETIME);
+  }
+  JournalPush((JournalRecord){.start    = start,
+                             .duration = JournalSince(start),
+                             .kind     = JournalKind_Action,
+                             .code     = JournalAction_Spawn,
+                             .arg0     = (u32)pid,
+                             .arg1     = Process_NeedsShell(command)});
+  if (pid != -1)
+  {
+    Debugf("Launcher: spawned %d in %llu us: %.*s", pid,
+           (unsigned long long)((TimeNow() - start) / Microsecons(1)), StrFmtVal(command));
+  }
+  return pid;
+}
+
+internal bool LauncherFindLaunch(i32 pid, LaunchRecord *record)
+{
+  ProfileZone("LauncherFindLaunch");
+  bool found = false;
+  u64  now   = TimeNow();
+  // The /proc walk is only worth it while launches are pending
+  for (u32 depth = 0; !found && pid > 1 && depth < 8 && g_launcher.next_expiry != UINT64_MAX;
+       depth += 1)
+  {
+    LaunchRecord *launch = LaunchMap_Find(&g_launcher.launches, (u32)pid);
+    if (launch && now - launch->time < LAUNCH_RECORD_LIFETIME)
+    {
+      *record = *launch;
+      found   = true;
+    }
+    else
+    {
+      pid = Process_ParentPid(pid);
+    }
+  }
+  return found;
+}
+
+internal void LauncherExpire(u64 now)
+{
+  if (now >= g_launcher.next_expiry)
+  {
+    ProfileZone("LauncherExpire");
+    g_launcher.next_expiry = UINT64_MAX;
+    for (u64 i = 0; i < g_launcher.launches.capacity;)
+    {
+      u32           pid    = g_launcher.launches.keys[i];
+      LaunchRecord *launch = &g_launcher.launches.values[i];
+      if (pid != 0 && now - launch->time >= LAUNCH_RECORD_LIFETIME)
+      {
+        // Removal shifts the following entries back, the slot is looked at again
+        LaunchMap_Remove(&g_launcher.launches, pid);
+      }
+      else
+      {
+        if (pid != 0)
+        {
+          u64 expiry             = launch->time + LAUNCH_RECORD_LIFETIME;
+          g_launcher.next_expiry = Min(g_launcher.next_expiry, expiry);
+        }
+        i += 1;
+      }
+    }
+  }
+}
+
+internal void LauncherReport()
+{
+  u64 total        = TimeNow() - g_launcher.start;
+  u64 blocking_sum = 0;
+  u64 blocking_max = 0;
+  for (u32 i = 0; i < g_launcher.count; i += 1)
+  {
+    StartupAction *action = &g_launcher.actions[i];
+    if (action->barrier)
+    {
+      Infof("Startup: %2u wait", i);
+    }
+    else if (action->blocking)
+    {
+      Infof("Startup: %2u exec            spawn %6llu us, run %8llu us, status 0x%x: %.*s", i,
+            (unsigned long long)(action->spawn_duration / Microsecons(1)),
+            (unsigned long long)(action->run_duration / Microsecons(1)), action->status,
+            StrFmtVal(action->command));
+      blocking_sum += action->run_duration;
+      blocking_max  = Max(blocking_max, action->run_duration);
+    }
+    else
+    {
+      Infof("Startup: %2u exec_background spawn %6llu us: %.*s", i,
+            (unsigned long long)(action->spawn_duration / Microsecons(1)),
+            StrFmtVal(action->command));
+    }
+  }
+  Infof("Startup: %u actions done in %llu us, blocking actions took %llu us in sum and %llu us "
+        "at most",
+        g_launcher.count, (unsigned long long)(total / Microsecons(1)),
+        (unsigned long long)(blocking_sum / Microsecons(1)),
+        (unsigned long long)(blocking_max / Microsecons(1)));
+}
+
+internal void LauncherStartAction(StartupAction *action)
+{
+  action->start          = TimeNow();
+  action->pid            = LauncherSpawn(action->command, g_launcher.startup_target.monitor,
+                                         g_launcher.startup_target.workspace);
+  action->spawn_duration = TimeNow() - action->start;
+  if (action->pid == -1)
+  {
+    action->status = -1;
+  }
+  else if (action->blocking)
+  {
+    g_launcher.blocking_running += 1;
+  }
+}
+
+/*
+Starts everything up to the next wait entry the running execs haven't passed yet
+*/
+internal void LauncherAdvance()
+{
+  for (; g_launcher.next < g_launcher.count; g_launcher.next += 1)
+  {
+    StartupAction *action = &g_launcher.actions[g_launcher.next];
+    if (action->barrier && g_launcher.blocking_running != 0)
+    {
+      break;
+    }
+    if (!action->barrier)
+    {
+      LauncherStartAction(action);
+    }
+  }
+  if (g_launcher.next == g_launcher.count && g_launcher.blocking_running == 0 &&
+      g_launcher.count != 0)
+  {
+    LauncherReport();
+    g_launcher.count = 0;
+  }
+}
+
+internal void LauncherRunStartupActions(const Config *config, u16 monitor, u16 workspace)
+{
+  ProfileZone("LauncherRunStartupActions");
+  g_launcher.start          = TimeNow();
+  g_launcher.startup_target = (LaunchRecord){.monitor = monitor, .workspace = workspace};
+  // Cloned, the config snapshot can be replaced by a reload while barriers are pending
+  g_launcher.actions =
+      ArenaAlloc(g_launcher.arena, sizeof(StartupAction) * config->startup_actions.size);
+  Allocator allocator = ArenaAllocator(g_launcher.arena);
+  for (u64 i = 0; i < config->startup_actions.size; i += 1)
+  {
+    String    line = config->startup_actions.data[i];
+    KeyAction action;
+    if (StrEquals(StrTrimSpaces(line), StrLit("wait")))
+    {
+      g_launcher.actions[g_launcher.count] = (StartupAction){.barrier = true, .pid = -1};
+      g_launcher.count += 1;
+      continue;
+    }
+    if (!KeyActionParse(line, line, &action) ||
+        (action.op != KeyActionOp_Exec && action.op != KeyActionOp_ExecBackground))
+    {
+      Errorf("Config: startup action %llu is not an exec, exec_background or wait: %.*s",
+             (unsigned long long)i, StrFmtVal(line));
+      continue;
+    }
+    String command = StrSubstr(line, action.arg.command.offset,
+                               action.arg.command.offset + action.arg.command.size);
+    g_launcher.actions[g_launcher.count] = (StartupAction){
+        .command  = StrClone(allocator, command),
+        .blocking = action.op == KeyActionOp_Exec,
+        .pid      = -1,
+    };
+    g_launcher.count += 1;
+  }
+  LauncherAdvance();
+}
+
+internal void LauncherReap(int reaper_fd)
+{
+  ProcessExit exits[16];
+  u32         count = sizeof exits / sizeof exits[0];
+  while (count == sizeof exits / sizeof exits[0])
+  {
+    count = Process_Reap(reaper_fd, exits, count);
+    for (u32 i = 0; i < count; i += 1)
+    {
+      JournalPush((JournalRecord){.start = TimeNow(),
+                                 .kind  = JournalKind_Action,
+                                 .code  = JournalAction_ChildExit,
+                                 .arg0  = (u32)exits[i].pid,
+                                 .arg1  = (u32)exits[i].status});
+      if (!WIFEXITED(exits[i].status) || WEXITSTATUS(exits[i].status) != 0)
+      {
+        Warnf("Launcher: child %d exited with status 0x%x", exits[i].pid, exits[i].status);
+      }
+      for (u32 j = 0; j < g_launcher.next && j < g_launcher.count; j += 1)
+      {
+        StartupAction *action = &g_launcher.actions[j];
+        if (action->pid == exits[i].pid)
+        {
+          action->run_duration = TimeNow() - action->start;
+          action->status       = exits[i].status;
+          if (action->blocking)
+          {
+            g_launcher.blocking_running -= 1;
+          }
+          break;
+        }
+      }
+    }
+  }
+  LauncherAdvance();
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef WM_LAUNCHER_H
+#define WM_LAUNCHER_H
+
+#include "../core/core.h"
+#include "config.h"
+
+// Windows mapped this long after their launch are placed like any other window
+#define LAUNCH_RECORD_LIFETIME Seconds(30ull)
+
+typedef struct
+{
+  u16 monitor;
+  u16 workspace;
+  u64 time;
+} LaunchRecord;
+
+/*
+Keyed by pid, pid 0 is never handed out so it marks empty slots
+*/
+internal u64  LaunchMapHash(u32 pid, u64 max);
+internal bool LaunchMapKeyEquals(u32 lhs, u32 rhs);
+internal bool LaunchMapKeyIsEmpty(u32 pid);
+
+EmptyKeyValueFuncTemplate(u32, LaunchRecord);
+HashMapTemplateFull(u32, LaunchRecord, LaunchMap, LaunchMap_, LaunchMapHash, LaunchMapKeyEquals,
+                    LaunchMapKeyIsEmpty, EmptyKeyValueDefault_u32_LaunchRecord, u64);
+
+typedef struct
+{
+  String command;
+  // exec entries are waited for by the next wait entry, exec_background ones are only spawned
+  bool   blocking;
+  // A wait entry, no command
+  bool   barrier;
+  i32    pid;
+  u64    start;
+  // Nanoseconds until the child exec'd, and until it exited for blocking actions
+  u64    spawn_duration;
+  u64    run_duration;
+  i32    status;
+} StartupAction;
+
+typedef struct
+{
+  Arena         *arena;
+  StartupAction *actions;
+  u32            count;
+  // First action not started yet
+  u32            next;
+  u32            blocking_running;
+  u64            start;
+  LaunchRecord   startup_target;
+  LaunchMap      launches;
+  // No record expires before this, the map is only scanned once it has passed
+  u64            next_expiry;
+} Launcher;
+
+internal void LauncherInit();
+internal void LauncherDeinit();
+/*
+Spawns the command and journals how long it took until the child exec'd, returns the pid or -1.
+The pid is recorded with the monitor and workspace its windows should be placed on.
+*/
+internal i32  LauncherSpawn(String command, u16 monitor, u16 workspace);
+/*
+Looks the pid up, then its ancestors through /proc so windows of children of a shell, or of a
+client's helper processes, are found as well. False if no unexpired launch matches.
+*/
+internal bool LauncherFindLaunch(i32 pid, LaunchRecord *record);
+/*
+Drops the records older than LAUNCH_RECORD_LIFETIME, cheap to call every frame
+*/
+internal void LauncherExpire(u64 now);
+/*
+Starts the startup actions without blocking the event loop. Everything up to the first wait
+entry is spawned at once, exec actions included, so blocking actions that don't depend on each
+other run side by side and take as long as the slowest one. A wait entry holds back the actions
+listed after it until every exec before it exited, for pairs like setxkbmap then xmodmap:
+    exec setxkbmap -layout us
+    wait
+    exec xmodmap ~/.Xmodmap
+The rest is driven by LauncherReap, a timing report is logged once the last exec exited.
+*/
+internal void LauncherRunStartupActions(const Config *config, u16 monitor, u16 workspace);
+/*
+Reaps every exited child, called when the reaper signalfd is readable
+*/
+internal void LauncherReap(int reaper_fd);
+
+#endif
\ No newline at end of file
@@ -1,29 +1,83 @@
+#include "journal.h"
 #include "config.h"
 #include "xcb.h"
 
 #include "../core/core.c"
+#include "journal.c"
 #include "config.c"
+#include "keyboard.c"
+#include "launcher.c"
 #include "xcb.c"
+#include "bsp.c"
 #include "workspace.c"
 #include "monitor.c"
 #include "randr.c"
 #include "window.c"
 
+#include <poll.h>
+
 int main(void)
 {
+  // SIGCHLD has to be blocked before the log writer and config loader threads start
+  int reaper_fd = Process_ReaperInit();
+  LogInit();
+  if (reaper_fd == -1)
+  {
+    Errorf("Failed to set up the SIGCHLD signalfd (errno: %d), children are reaped every frame",
+           errno);
+  }
+  // The runtime dir is private to the user, a shared one like /tmp would let others plant the file
+  char  journal_default[4096];
+  char *journal_path = getenv("WM_JOURNAL");
+  char *runtime_dir  = getenv("XDG_RUNTIME_DIR");
+  if (!journal_path && runtime_dir)
+  {
+    snprintf(journal_default, sizeof journal_default, "%s/x11_wm.journal", runtime_dir);
+    journal_path = journal_default;
+  }
+  if (journal_path)
+  {
+    JournalInit(journal_path, 1 << 16);
+  }
+  else
+  {
+    Info("Journal: XDG_RUNTIME_DIR is not set, set WM_JOURNAL to record one");
+  }
+  // Chrome trace-event recording is only on when a destination is given
+  char *trace_path = getenv("WM_TRACE");
+  if (trace_path)
+  {
+    TraceInit(trace_path);
+  }
+  ProfilerInit(getenv("WM_PROFILE") != NULL);
   Arena    *arena     = ArenaInit(Gigabytes(1));
   Allocator allocator = ArenaAllocator(arena);
 
   // String root_dir    = StrLit(PROJECT_DIR);
   String wm_name = StrLit("X11 Handmade WM");
 
-  Config config  = {0};
-  if (!LoadConfig(allocator, &config) || !Xcb_Init(allocator, wm_name))
+  int     config_watch_fd = ConfigInit(allocator);
+  Config *config          = LoadConfig();
+  if (!config || !Xcb_Init(allocator, wm_name))
   {
     Error("Failed to complete an initialization step");
+    ConfigDeinit();
+    Process_ReaperDeinit(reaper_fd);
+    TraceDeinit();
+    JournalDeinit();
+    LogDeinit();
     return 1;
   }
-  // PrintConfig(allocator, &config);
+  // PrintConfig(allocator, config);
+  {
+    Temp       temp = TempBegin(arena);
+    ConfigDiff diff = ConfigDiffCompute(allocator, NULL, config);
+    Xcb_ApplyConfig(config, &diff);
+    TempEnd(temp);
+  }
+  LauncherInit();
+  u16 startup_monitor = MonitorActive();
+  LauncherRunStartupActions(config, startup_monitor, MonitorActiveWorkspace(startup_monitor));
 
   const u64 frame_time = Seconds(1) / 60;
   bool      running    = true;
@@ -31,6 +85,7 @@ int main(void)
   {
     u64 frame_start = TimeNow();
 
+    TraceBegin("frame");
     Temp temp = TempBegin(arena);
     {
       if(!Xcb_PollEvents())
@@ -39,16 +94,56 @@ int main(void)
       }
     }
     TempEnd(temp);
+    TraceEnd();
+    ProfilerPollReport();
+
+    LauncherExpire(TimeNow());
+    if (ConfigReloadDue(TimeNow()))
+    {
+      ConfigRequestReload();
+    }
+    Config *reloaded = ConfigTakeReloaded();
+    if (reloaded)
+    {
+      // The diff slices into both snapshots, the previous one can only go once it's applied
+      Temp       temp = TempBegin(arena);
+      ConfigDiff diff = ConfigDiffCompute(allocator, config, reloaded);
+      Xcb_ApplyConfig(reloaded, &diff);
+      TempEnd(temp);
+      ConfigFree(config);
+      config = reloaded;
+    }
+    Xcb_Layout();
 
     u64 frame_end = TimeNow();
     u64 diff      = frame_end - frame_start;
     if (diff < frame_time)
     {
-      Sleep(frame_time - diff);
+      // Sleep till the next frame unless X, the config watch or an exited child have something
+      // for us earlier
+      struct pollfd fds[3] = {
+          {.fd = Xcb_Flush(), .events = POLLIN},
+          {.fd = config_watch_fd, .events = POLLIN},
+          {.fd = reaper_fd, .events = POLLIN},
+      };
+      int timeout_ms = (int)((frame_time - diff + Milliseconds(1) - 1) / Milliseconds(1));
+      // Without the signalfd children are looked for every frame
+      if ((poll(fds, 3, timeout_ms) > 0 && (fds[2].revents & POLLIN)) || reaper_fd == -1)
+      {
+        LauncherReap(reaper_fd);
+      }
     }
   }
 
   Xcb_Deinit();
+  ConfigFree(config);
+  ConfigDeinit();
+  LauncherDeinit();
+  Process_ReaperDeinit(reaper_fd);
+  ProfilerReport();
   ArenaDeinit(arena);
+  TraceDeinit();
+  JournalDeinit();
+  LogDeinit();
   return 0;
 }
\ No newline at end of file
@@ -1,6 +1,77 @@
 #include "monitor.h"
 
-internal void AddMonitor(Allocator allocator, String name, bool primary, u16 output, i16 x, i16 y,
+ArrayMonitor g_monitors;
+// The primary monitor until focus moves between monitors
+u16          g_active_monitor;
+
+internal void AddMonitor(Allocator allocator, StrId name, bool primary, u16 output, i16 x, i16 y,
                          u16 width, u16 height)
 {
+  Monitor monitor = {.name    = name,
+                     .primary = primary,
+                     .output  = output,
+                     .x       = x,
+                     .y       = y,
+                     .width   = width,
+                     .height  = height};
+  if (ArrayMonitor_Push(allocator, &g_monitors, monitor) == AllocationError_None && primary)
+  {
+    g_active_monitor = (u16)(g_monitors.size - 1);
+  }
+}
+
+internal u16 MonitorActive()
+{
+  return g_active_monitor;
+}
+
+internal u16 MonitorActiveWorkspace(u16 monitor)
+{
+  return monitor < g_monitors.size ? (u16)g_monitors.data[monitor].active_workspace : 0;
+}
+
+internal Workspace *MonitorWorkspace(Allocator allocator, u16 monitor, u16 workspace)
+{
+  Workspace *res = NULL;
+  if (monitor < g_monitors.size)
+  {
+    Monitor *owner = &g_monitors.data[monitor];
+    if (owner->workspaces.capacity == 0)
+    {
+      owner->workspaces = ArrayWorkspace_Init(allocator, workspace + 1);
+    }
+    Rect area = {.x = owner->x, .y = owner->y, .width = owner->width, .height = owner->height};
+    bool ok   = true;
+    while (ok && owner->workspaces.size <= workspace)
+    {
+      Workspace created = WorkspaceInit((u16)owner->workspaces.size, area);
+      created.hidden    = created.id != owner->active_workspace;
+      ok = ArrayWorkspace_Push(allocator, &owner->workspaces, created) == AllocationError_None;
+    }
+    res = ok ? &owner->workspaces.data[workspace] : NULL;
+  }
+  return res;
+}
+
+internal ArrayWorkspace *MonitorWorkspaces(u16 monitor)
+{
+  return monitor < g_monitors.size ? &g_monitors.data[monitor].workspaces : NULL;
+}
+
+internal bool MonitorSwitchWorkspace(Allocator allocator, u16 monitor, u16 workspace,
+                                     WindowsSystem *windows)
+{
+  ProfileZone("MonitorSwitchWorkspace");
+  bool res    = false;
+  u16  active = MonitorActiveWorkspace(monitor);
+  // Creating a workspace may move the others, so both exist before either pointer is taken
+  if (workspace != active && MonitorWorkspace(allocator, monitor, Max(active, workspace)))
+  {
+    Monitor *owner = &g_monitors.data[monitor];
+    WorkspaceHide(&owner->workspaces.data[active], windows);
+    WorkspaceShow(&owner->workspaces.data[workspace], windows);
+    owner->active_workspace = workspace;
+    res                     = true;
+  }
+  return res;
 }
\ No newline at end of file
@@ -7,7 +7,7 @@ ArrayTemplate(Workspace);
 
 typedef struct
 {
-  xcb_atom_t     name;
+  StrId          name;
   bool           primary;
   u16            output;
   i16            x;
@@ -20,7 +20,27 @@ typedef struct
 
 ArrayTemplate(Monitor);
 
-internal void AddMonitor(Allocator allocator, String name, bool primary, u16 output, i16 x, i16 y,
-                         u16 width, u16 height);
+internal void            AddMonitor(Allocator allocator, StrId name, bool primary, u16 output,
+                                    i16 x, i16 y, u16 width, u16 height);
+internal u16             MonitorActive();
+/*
+Workspace shown on the monitor, 0 for monitors that aren't known
+*/
+internal u16             MonitorActiveWorkspace(u16 monitor);
+/*
+Workspaces are created on first use, over the whole monitor. NULL for monitors that aren't known.
+*/
+internal Workspace      *MonitorWorkspace(Allocator allocator, u16 monitor, u16 workspace);
+/*
+Every workspace created so far on the monitor, NULL past the last monitor
+*/
+internal ArrayWorkspace *MonitorWorkspaces(u16 monitor);
+/*
+Hides the workspace shown on the monitor and shows the other one, creating it if needed. Only
+the desired geometry changes, the next layout pass sends it. False if the workspace was already
+shown or the monitor isn't known.
+*/
+internal bool            MonitorSwitchWorkspace(Allocator allocator, u16 monitor, u16 workspace,
+                                                WindowsSystem *windows);
 
 #endif
\ No newline at end of file
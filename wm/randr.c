@@ -24,10 +24,14 @@ internal bool RandrInit(Allocator allocator, xcb_connection_t *conn, xcb_window_
   {
     *randr_event_base = extreply->first_event;
 
-    xcb_generic_error_t *err;
-    randr_version = xcb_randr_query_version_reply(
-        conn, xcb_randr_query_version(conn, XCB_RANDR_MAJOR_VERSION, XCB_RANDR_MINOR_VERSION),
-        &err);
+    xcb_generic_error_t             *err;
+    xcb_randr_query_version_cookie_t version_cookie =
+        xcb_randr_query_version(conn, XCB_RANDR_MAJOR_VERSION, XCB_RANDR_MINOR_VERSION);
+    TraceFlowStart("RandrQueryVersion", version_cookie.sequence);
+    TraceBegin("xcb_randr_query_version_reply");
+    randr_version = xcb_randr_query_version_reply(conn, version_cookie, &err);
+    TraceFlowEnd("RandrQueryVersion", version_cookie.sequence);
+    TraceEnd();
     if (err != NULL)
     {
       Errorf("Could not query RandR version: X11 error code %d", err->error_code);
@@ -53,9 +57,14 @@ internal bool RandrQueryOutputs(Allocator allocator, xcb_connection_t *conn, xcb
   bool ok = true;
   if (g_has_randr_1_5)
   {
-    xcb_generic_error_t                  *err;
+    xcb_generic_error_t            *err;
+    xcb_randr_get_monitors_cookie_t monitors_cookie = xcb_randr_get_monitors(conn, root, true);
+    TraceFlowStart("RandrGetMonitors", monitors_cookie.sequence);
+    TraceBegin("xcb_randr_get_monitors_reply");
     const xcb_randr_get_monitors_reply_t *reply =
-        xcb_randr_get_monitors_reply(conn, xcb_randr_get_monitors(conn, root, true), &err);
+        xcb_randr_get_monitors_reply(conn, monitors_cookie, &err);
+    TraceFlowEnd("RandrGetMonitors", monitors_cookie.sequence);
+    TraceEnd();
     if (err)
     {
       Errorf("Failed to get Randr monitors, error code: %d", err->error_code);
@@ -68,19 +77,25 @@ internal bool RandrQueryOutputs(Allocator allocator, xcb_connection_t *conn, xcb
            iter.rem; xcb_randr_monitor_info_next(&iter))
       {
         xcb_randr_monitor_info_t  *monitor_info = iter.data;
-        xcb_get_atom_name_reply_t *atom_reply =
-            xcb_get_atom_name_reply(conn, xcb_get_atom_name(conn, monitor_info->name), &err);
+        xcb_get_atom_name_cookie_t atom_cookie = xcb_get_atom_name(conn, monitor_info->name);
+        TraceFlowStart("GetAtomName", atom_cookie.sequence);
+        TraceBegin("xcb_get_atom_name_reply");
+        xcb_get_atom_name_reply_t *atom_reply = xcb_get_atom_name_reply(conn, atom_cookie, &err);
+        TraceFlowEnd("GetAtomName", atom_cookie.sequence);
+        TraceEnd();
         if (err != NULL)
         {
           Errorf("Could not get RandR monitor name: X11 error code %d", err->error_code);
           free(err);
           continue;
         }
-        String name =
-            Str(xcb_get_atom_name_name(atom_reply), xcb_get_atom_name_name_length(atom_reply));
+        StrId name = StrIntern(&g_strings, Str(xcb_get_atom_name_name(atom_reply),
+                                               xcb_get_atom_name_name_length(atom_reply)));
+        free(atom_reply);
         Debugf("Randr monitor name: %.*s, primary: %d, output: %d, x: %d, y: %d, width: %d, height: %d",
-               StrFmtVal(name), monitor_info->primary, monitor_info->nOutput, monitor_info->x,
-               monitor_info->y, monitor_info->width, monitor_info->height);
+               StrFmtVal(StrFromId(&g_strings, name)), monitor_info->primary,
+               monitor_info->nOutput, monitor_info->x, monitor_info->y, monitor_info->width,
+               monitor_info->height);
         AddMonitor(allocator, name, monitor_info->primary == 1, monitor_info->nOutput,
                    monitor_info->x, monitor_info->y, monitor_info->width, monitor_info->height);
       }
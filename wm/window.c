@@ -1,18 +1,262 @@
 #include "window.h"
 
+// Geometry lanes for the diff and the nearest search, one u16 or i16 column entry each. AVX2 is
+// picked up by release builds (-march=native), SSE2 is the x86-64 baseline, everything else goes
+// through the scalar loop.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define WINDOW_SIMD_WIDTH 16
+typedef __m256i WindowSimd;
+
+internal WindowSimd WindowSimd_Load(const void *p)
+{
+  return _mm256_loadu_si256((const __m256i *)p);
+}
+
+internal WindowSimd WindowSimd_Splat(u16 value)
+{
+  return _mm256_set1_epi16((short)value);
+}
+
+/*
+bit in the lanes where a and b differ, 0 elsewhere
+*/
+internal WindowSimd WindowSimd_NeqBit(WindowSimd a, WindowSimd b, u16 bit)
+{
+  return _mm256_andnot_si256(_mm256_cmpeq_epi16(a, b), _mm256_set1_epi16((short)bit));
+}
+
+internal WindowSimd WindowSimd_Or(WindowSimd a, WindowSimd b)
+{
+  return _mm256_or_si256(a, b);
+}
+
+/*
+Two bits per lane, set for the lanes that aren't zero
+*/
+internal u32 WindowSimd_NonZeroMask(WindowSimd a)
+{
+  return ~(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi16(a, _mm256_setzero_si256()));
+}
+
+internal void WindowSimd_Store(u16 *p, WindowSimd a)
+{
+  _mm256_storeu_si256((__m256i *)p, a);
+}
+
+/*
+16 u8 entries widened to u16 lanes
+*/
+internal WindowSimd WindowSimd_LoadU8(const u8 *p)
+{
+  return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+}
+
+internal WindowSimd WindowSimd_And(WindowSimd a, WindowSimd b)
+{
+  return _mm256_and_si256(a, b);
+}
+
+/*
+~a & b
+*/
+internal WindowSimd WindowSimd_AndNot(WindowSimd a, WindowSimd b)
+{
+  return _mm256_andnot_si256(a, b);
+}
+
+internal WindowSimd WindowSimd_Eq(WindowSimd a, WindowSimd b)
+{
+  return _mm256_cmpeq_epi16(a, b);
+}
+
+/*
+Signed a > b
+*/
+internal WindowSimd WindowSimd_Gt(WindowSimd a, WindowSimd b)
+{
+  return _mm256_cmpgt_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_Min(WindowSimd a, WindowSimd b)
+{
+  return _mm256_min_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_Max(WindowSimd a, WindowSimd b)
+{
+  return _mm256_max_epi16(a, b);
+}
+
+/*
+Signed saturating a + b and a - b, unsigned saturating a + b
+*/
+internal WindowSimd WindowSimd_AddSat(WindowSimd a, WindowSimd b)
+{
+  return _mm256_adds_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_SubSat(WindowSimd a, WindowSimd b)
+{
+  return _mm256_subs_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_AddSatU(WindowSimd a, WindowSimd b)
+{
+  return _mm256_adds_epu16(a, b);
+}
+
+internal WindowSimd WindowSimd_Half(WindowSimd a)
+{
+  return _mm256_srli_epi16(a, 1);
+}
+
+/*
+a in the lanes the mask is set in, b elsewhere
+*/
+internal WindowSimd WindowSimd_Select(WindowSimd mask, WindowSimd a, WindowSimd b)
+{
+  return _mm256_blendv_epi8(b, a, mask);
+}
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define WINDOW_SIMD_WIDTH 8
+typedef __m128i WindowSimd;
+
+internal WindowSimd WindowSimd_Load(const void *p)
+{
+  return _mm_loadu_si128((const __m128i *)p);
+}
+
+internal WindowSimd WindowSimd_Splat(u16 value)
+{
+  return _mm_set1_epi16((short)value);
+}
+
+internal WindowSimd WindowSimd_NeqBit(WindowSimd a, WindowSimd b, u16 bit)
+{
+  return _mm_andnot_si128(_mm_cmpeq_epi16(a, b), _mm_set1_epi16((short)bit));
+}
+
+internal WindowSimd WindowSimd_Or(WindowSimd a, WindowSimd b)
+{
+  return _mm_or_si128(a, b);
+}
+
+internal u32 WindowSimd_NonZeroMask(WindowSimd a)
+{
+  return ~(u32)_mm_movemask_epi8(_mm_cmpeq_epi16(a, _mm_setzero_si128())) & 0xFFFF;
+}
+
+internal void WindowSimd_Store(u16 *p, WindowSimd a)
+{
+  _mm_storeu_si128((__m128i *)p, a);
+}
+
+internal WindowSimd WindowSimd_LoadU8(const u8 *p)
+{
+  return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128());
+}
+
+internal WindowSimd WindowSimd_And(WindowSimd a, WindowSimd b)
+{
+  return _mm_and_si128(a, b);
+}
+
+internal WindowSimd WindowSimd_AndNot(WindowSimd a, WindowSimd b)
+{
+  return _mm_andnot_si128(a, b);
+}
+
+internal WindowSimd WindowSimd_Eq(WindowSimd a, WindowSimd b)
+{
+  return _mm_cmpeq_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_Gt(WindowSimd a, WindowSimd b)
+{
+  return _mm_cmpgt_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_Min(WindowSimd a, WindowSimd b)
+{
+  return _mm_min_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_Max(WindowSimd a, WindowSimd b)
+{
+  return _mm_max_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_AddSat(WindowSimd a, WindowSimd b)
+{
+  return _mm_adds_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_SubSat(WindowSimd a, WindowSimd b)
+{
+  return _mm_subs_epi16(a, b);
+}
+
+internal WindowSimd WindowSimd_AddSatU(WindowSimd a, WindowSimd b)
+{
+  return _mm_adds_epu16(a, b);
+}
+
+internal WindowSimd WindowSimd_Half(WindowSimd a)
+{
+  return _mm_srli_epi16(a, 1);
+}
+
+// SSE2 has no blendv
+internal WindowSimd WindowSimd_Select(WindowSimd mask, WindowSimd a, WindowSimd b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+internal u64 WindowIndexHash(xcb_window_t id, u64 max)
+{
+  return ((u64)id * 11400714819323198485ull >> 32) % max;
+}
+
+internal bool WindowIndexKeyEquals(xcb_window_t lhs, xcb_window_t rhs)
+{
+  return lhs == rhs;
+}
+
+internal bool WindowIndexKeyIsEmpty(xcb_window_t id)
+{
+  return id == 0;
+}
+
 internal WindowsSystem WindowsSystemInit(Allocator allocator, u16 capacity)
 {
   Assert(capacity > 0);
   WindowsSystem res;
-  res.size         = 0;
-  res.capacity     = capacity;
-  res.ids          = Alloc(xcb_window_t, res.capacity);
-  res.xs           = Alloc(i16, res.capacity);
-  res.ys           = Alloc(i16, res.capacity);
-  res.widths       = Alloc(u16, res.capacity);
-  res.heights      = Alloc(u16, res.capacity);
-  res.window_types = Alloc(WindowType, res.capacity);
-  if (!res.ids || !res.xs || !res.widths || !res.heights)
+  res.size           = 0;
+  res.capacity       = capacity;
+  res.ids            = Alloc(xcb_window_t, res.capacity);
+  res.xs             = Alloc(i16, res.capacity);
+  res.ys             = Alloc(i16, res.capacity);
+  res.widths         = Alloc(u16, res.capacity);
+  res.heights        = Alloc(u16, res.capacity);
+  res.borders        = Alloc(u16, res.capacity);
+  res.shown_xs       = Alloc(i16, res.capacity);
+  res.sent_xs        = Alloc(i16, res.capacity);
+  res.sent_ys        = Alloc(i16, res.capacity);
+  res.sent_widths    = Alloc(u16, res.capacity);
+  res.sent_heights   = Alloc(u16, res.capacity);
+  res.sent_borders   = Alloc(u16, res.capacity);
+  res.window_types   = Alloc(WindowType, res.capacity);
+  res.class_names    = Alloc(StrId, res.capacity);
+  res.instance_names = Alloc(StrId, res.capacity);
+  res.monitors       = Alloc(u16, res.capacity);
+  res.workspaces     = Alloc(u16, res.capacity);
+  res.lists          = Alloc(WindowList, res.capacity);
+  res.positions      = Alloc(u16, res.capacity);
+  res.indices        = WindowIndexMap_Init(allocator, (u64)res.capacity * 2);
+  if (!res.ids || !res.xs || !res.widths || !res.heights || !res.indices.capacity)
   {
     res.capacity = 0;
   }
@@ -28,7 +272,21 @@ internal void WindowsSystemDeinit(Allocator allocator, WindowsSystem *array)
     Free(array->ys, array->capacity);
     Free(array->widths, array->capacity);
     Free(array->heights, array->capacity);
+    Free(array->borders, array->capacity);
+    Free(array->shown_xs, array->capacity);
+    Free(array->sent_xs, array->capacity);
+    Free(array->sent_ys, array->capacity);
+    Free(array->sent_widths, array->capacity);
+    Free(array->sent_heights, array->capacity);
+    Free(array->sent_borders, array->capacity);
     Free(array->window_types, array->capacity);
+    Free(array->class_names, array->capacity);
+    Free(array->instance_names, array->capacity);
+    Free(array->monitors, array->capacity);
+    Free(array->workspaces, array->capacity);
+    Free(array->lists, array->capacity);
+    Free(array->positions, array->capacity);
+    WindowIndexMap_Deinit(allocator, &array->indices);
     array->capacity = 0;
     array->size     = 0;
   }
@@ -64,13 +322,45 @@ internal AllocationError WindowsSystemPush(Allocator allocator, WindowsSystem *a
     _Realloc(ys, i16);
     _Realloc(widths, u16);
     _Realloc(heights, u16);
+    _Realloc(borders, u16);
+    _Realloc(shown_xs, i16);
+    _Realloc(sent_xs, i16);
+    _Realloc(sent_ys, i16);
+    _Realloc(sent_widths, u16);
+    _Realloc(sent_heights, u16);
+    _Realloc(sent_borders, u16);
     _Realloc(window_types, WindowType);
+    _Realloc(class_names, StrId);
+    _Realloc(instance_names, StrId);
+    _Realloc(monitors, u16);
+    _Realloc(workspaces, u16);
+    _Realloc(lists, WindowList);
+    _Realloc(positions, u16);
 
 #undef _Realloc
   }
+  if (res == AllocationError_None &&
+      !WindowIndexMap_Push(allocator, &array->indices, id, array->size))
+  {
+    res = AllocationError_OutOfMemory;
+  }
   if (res == AllocationError_None)
   {
-    array->ids[array->size] = id;
+    u16 index                  = array->size;
+    array->ids[index]          = id;
+    array->xs[index]           = x;
+    array->ys[index]           = y;
+    array->widths[index]       = width;
+    array->heights[index]      = height;
+    array->borders[index]      = 0;
+    array->shown_xs[index]     = x;
+    array->sent_xs[index]      = x;
+    array->sent_ys[index]      = y;
+    array->sent_widths[index]  = width;
+    array->sent_heights[index] = height;
+    array->sent_borders[index] = 0;
+    array->lists[index]        = WindowList_None;
+    array->positions[index]    = 0;
     array->size += 1;
   }
   return res;
@@ -78,14 +368,329 @@ internal AllocationError WindowsSystemPush(Allocator allocator, WindowsSystem *a
 
 internal void WindowsSystemUnorderedRemove(WindowsSystem *array, u16 index)
 {
+  WindowIndexMap_Remove(&array->indices, array->ids[index]);
   if (index + 1 < array->size)
   {
+    *WindowIndexMap_Find(&array->indices, array->ids[array->size - 1]) = index;
     SwapT(array->ids[index], array->ids[array->size - 1], xcb_window_t);
     SwapT(array->xs[index], array->xs[array->size - 1], i16);
     SwapT(array->ys[index], array->ys[array->size - 1], i16);
     SwapT(array->widths[index], array->widths[array->size - 1], u16);
     SwapT(array->heights[index], array->heights[array->size - 1], u16);
+    SwapT(array->borders[index], array->borders[array->size - 1], u16);
+    SwapT(array->shown_xs[index], array->shown_xs[array->size - 1], i16);
+    SwapT(array->sent_xs[index], array->sent_xs[array->size - 1], i16);
+    SwapT(array->sent_ys[index], array->sent_ys[array->size - 1], i16);
+    SwapT(array->sent_widths[index], array->sent_widths[array->size - 1], u16);
+    SwapT(array->sent_heights[index], array->sent_heights[array->size - 1], u16);
+    SwapT(array->sent_borders[index], array->sent_borders[array->size - 1], u16);
     SwapT(array->window_types[index], array->window_types[array->size - 1], u16);
+    SwapT(array->class_names[index], array->class_names[array->size - 1], StrId);
+    SwapT(array->instance_names[index], array->instance_names[array->size - 1], StrId);
+    SwapT(array->monitors[index], array->monitors[array->size - 1], u16);
+    SwapT(array->workspaces[index], array->workspaces[array->size - 1], u16);
+    SwapT(array->lists[index], array->lists[array->size - 1], WindowList);
+    SwapT(array->positions[index], array->positions[array->size - 1], u16);
   }
   array->size -= 1;
+}
+
+internal i32 WindowsSystemFind(WindowsSystem *array, xcb_window_t id)
+{
+  u16 *index = WindowIndexMap_Find(&array->indices, id);
+  return index ? *index : -1;
+}
+
+internal u16 WindowsSystemGeometryChanges(WindowsSystem *array, u16 *from,
+                                          WindowGeometryChange *changes, u16 capacity)
+{
+  ProfileZone("WindowsSystemGeometryChanges");
+  u16 count = 0;
+  u16 i     = *from;
+#ifdef WINDOW_SIMD_WIDTH
+  // A vector of windows is only taken when all of its changes fit
+  for (; i + WINDOW_SIMD_WIDTH <= array->size && count + WINDOW_SIMD_WIDTH <= capacity;
+       i += WINDOW_SIMD_WIDTH)
+  {
+    WindowSimd masks = WindowSimd_NeqBit(WindowSimd_Load(&array->xs[i]),
+                                         WindowSimd_Load(&array->sent_xs[i]), XCB_CONFIG_WINDOW_X);
+    masks = WindowSimd_Or(masks, WindowSimd_NeqBit(WindowSimd_Load(&array->ys[i]),
+                                                   WindowSimd_Load(&array->sent_ys[i]),
+                                                   XCB_CONFIG_WINDOW_Y));
+    masks = WindowSimd_Or(masks, WindowSimd_NeqBit(WindowSimd_Load(&array->widths[i]),
+                                                   WindowSimd_Load(&array->sent_widths[i]),
+                                                   XCB_CONFIG_WINDOW_WIDTH));
+    masks = WindowSimd_Or(masks, WindowSimd_NeqBit(WindowSimd_Load(&array->heights[i]),
+                                                   WindowSimd_Load(&array->sent_heights[i]),
+                                                   XCB_CONFIG_WINDOW_HEIGHT));
+    masks = WindowSimd_Or(masks, WindowSimd_NeqBit(WindowSimd_Load(&array->borders[i]),
+                                                   WindowSimd_Load(&array->sent_borders[i]),
+                                                   XCB_CONFIG_WINDOW_BORDER_WIDTH));
+    u32 changed = WindowSimd_NonZeroMask(masks);
+    if (changed)
+    {
+      u16 lanes[WINDOW_SIMD_WIDTH];
+      WindowSimd_Store(lanes, masks);
+      while (changed)
+      {
+        // Every lane owns two mask bits
+        u32 lane = (u32)__builtin_ctz(changed) / 2;
+        changed &= ~(3u << (lane * 2));
+        changes[count] = (WindowGeometryChange){.index      = (u16)(i + lane),
+                                                .value_mask = lanes[lane]};
+        count += 1;
+      }
+    }
+  }
+#endif
+  for (; i < array->size && count < capacity; i += 1)
+  {
+    u16 mask = 0;
+    mask |= array->xs[i] != array->sent_xs[i] ? XCB_CONFIG_WINDOW_X : 0;
+    mask |= array->ys[i] != array->sent_ys[i] ? XCB_CONFIG_WINDOW_Y : 0;
+    mask |= array->widths[i] != array->sent_widths[i] ? XCB_CONFIG_WINDOW_WIDTH : 0;
+    mask |= array->heights[i] != array->sent_heights[i] ? XCB_CONFIG_WINDOW_HEIGHT : 0;
+    mask |= array->borders[i] != array->sent_borders[i] ? XCB_CONFIG_WINDOW_BORDER_WIDTH : 0;
+    if (mask)
+    {
+      changes[count] = (WindowGeometryChange){.index = i, .value_mask = mask};
+      count += 1;
+    }
+  }
+  *from = i;
+  return count;
+}
+
+internal void WindowsSystemMarkSent(WindowsSystem *array, u16 index)
+{
+  array->sent_xs[index]      = array->xs[index];
+  array->sent_ys[index]      = array->ys[index];
+  array->sent_widths[index]  = array->widths[index];
+  array->sent_heights[index] = array->heights[index];
+  array->sent_borders[index] = array->borders[index];
+}
+
+internal i16 WindowSat16(i32 value)
+{
+  return (i16)Clamp(INT16_MIN, value, INT16_MAX);
+}
+
+/*
+Size plus both borders, saturated to i16 like the lanes do it
+*/
+internal i16 WindowExtent(u16 size, u16 border)
+{
+  return (i16)Min((i32)size + 2 * (i32)border, INT16_MAX);
+}
+
+internal WindowNearestQuery WindowNearestQueryOf(WindowsSystem *array, u16 from,
+                                                 Direction direction)
+{
+  WindowNearestQuery res = {0};
+  res.from               = from;
+  res.monitor            = array->monitors[from];
+  res.workspace          = array->workspaces[from];
+  res.vertical           = direction == Direction_Up || direction == Direction_Down;
+  res.backward           = direction == Direction_Left || direction == Direction_Up;
+  i16 along              = res.vertical ? array->ys[from] : array->xs[from];
+  i16 across             = res.vertical ? array->xs[from] : array->ys[from];
+  i16 along_extent  = WindowExtent(res.vertical ? array->heights[from] : array->widths[from],
+                                   array->borders[from]);
+  i16 across_extent = WindowExtent(res.vertical ? array->widths[from] : array->heights[from],
+                                   array->borders[from]);
+  i16 start         = along;
+  res.end           = WindowSat16(start + along_extent);
+  if (res.backward)
+  {
+    start   = WindowSat16(-res.end);
+    res.end = WindowSat16(-along);
+  }
+  res.center      = WindowSat16(start + along_extent / 2);
+  res.perp_start  = across;
+  res.perp_end    = WindowSat16(across + across_extent);
+  res.perp_center = WindowSat16(across + across_extent / 2);
+  return res;
+}
+
+/*
+Scores the window at index against the query, false if it isn't a candidate. primary is the
+distance along the direction, plus 0x4000 when the window doesn't overlap the focused one
+across it, secondary the distance between their centers across it. Lower is nearer.
+*/
+internal bool WindowNearestScore(WindowsSystem *array, const WindowNearestQuery *query, u16 index,
+                                 i16 *primary, i16 *secondary)
+{
+  bool vertical      = query->vertical;
+  i16  along         = vertical ? array->ys[index] : array->xs[index];
+  i16  across        = vertical ? array->xs[index] : array->ys[index];
+  i16  along_extent  = WindowExtent(vertical ? array->heights[index] : array->widths[index],
+                                    array->borders[index]);
+  i16  across_extent = WindowExtent(vertical ? array->widths[index] : array->heights[index],
+                                    array->borders[index]);
+  i16  start         = along;
+  if (query->backward)
+  {
+    start = WindowSat16(-WindowSat16(along + along_extent));
+  }
+  bool res = index != query->from && array->monitors[index] == query->monitor &&
+             array->workspaces[index] == query->workspace &&
+             array->lists[index] == WindowList_NormalMapped && start > query->center;
+  if (res)
+  {
+    i16  across_end    = WindowSat16(across + across_extent);
+    i16  across_center = WindowSat16(across + across_extent / 2);
+    bool overlap       = across < query->perp_end && across_end > query->perp_start;
+    i16  distance      = (i16)Min(Max(WindowSat16(start - query->end), 0), 0x3FFE);
+    i16  offset        = WindowSat16(across_center - query->perp_center);
+    *primary           = (i16)(distance + (overlap ? 0 : 0x4000));
+    *secondary         = (i16)Min(Max(offset, WindowSat16(-offset)), 0x7FFE);
+  }
+  return res;
+}
+
+internal i32 WindowsSystemNearestScalar(WindowsSystem *array, u16 from, Direction direction)
+{
+  WindowNearestQuery query = WindowNearestQueryOf(array, from, direction);
+  i32                res   = -1;
+  i16                best_primary;
+  i16                best_secondary;
+  for (u16 i = 0; i < array->size; i += 1)
+  {
+    i16 primary;
+    i16 secondary;
+    if (WindowNearestScore(array, &query, i, &primary, &secondary) &&
+        (res == -1 || primary < best_primary ||
+         (primary == best_primary && secondary < best_secondary)))
+    {
+      res            = i;
+      best_primary   = primary;
+      best_secondary = secondary;
+    }
+  }
+  return res;
+}
+
+internal i32 WindowsSystemNearest(WindowsSystem *array, u16 from, Direction direction)
+{
+  ProfileZone("WindowsSystemNearest");
+  WindowNearestQuery query          = WindowNearestQueryOf(array, from, direction);
+  i32                res            = -1;
+  i16                best_primary   = 0x7FFF;
+  i16                best_secondary = 0x7FFF;
+  u16                i              = 0;
+#ifdef WINDOW_SIMD_WIDTH
+  static const u16 lane_numbers[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  i16             *alongs           = query.vertical ? array->ys : array->xs;
+  i16             *acrosses         = query.vertical ? array->xs : array->ys;
+  u16             *along_sizes      = query.vertical ? array->heights : array->widths;
+  u16             *across_sizes     = query.vertical ? array->widths : array->heights;
+  WindowSimd       none             = WindowSimd_Splat(0x7FFF);
+  WindowSimd       zero             = WindowSimd_Splat(0);
+  WindowSimd       lanes_primary    = none;
+  WindowSimd       lanes_secondary  = none;
+  WindowSimd       lanes_index      = zero;
+  WindowSimd       past_size        = WindowSimd_Splat((u16)(UINT16_MAX - array->size));
+  // The columns are allocated to capacity, lanes past the size are read and masked out, so a
+  // handful of windows is one pass and not the scalar tail
+  for (; i < array->size && i + WINDOW_SIMD_WIDTH <= array->capacity; i += WINDOW_SIMD_WIDTH)
+  {
+    WindowSimd index = WindowSimd_AddSatU(WindowSimd_Splat(i), WindowSimd_Load(lane_numbers));
+    // index + (UINT16_MAX - size) only saturates for index >= size
+    WindowSimd candidate = WindowSimd_AndNot(WindowSimd_Eq(WindowSimd_AddSatU(index, past_size),
+                                                           WindowSimd_Splat(UINT16_MAX)),
+                                             WindowSimd_Eq(WindowSimd_Load(&array->monitors[i]),
+                                                           WindowSimd_Splat(query.monitor)));
+    candidate =
+        WindowSimd_And(candidate, WindowSimd_Eq(WindowSimd_Load(&array->workspaces[i]),
+                                                WindowSimd_Splat(query.workspace)));
+    candidate = WindowSimd_And(candidate,
+                               WindowSimd_Eq(WindowSimd_LoadU8((const u8 *)&array->lists[i]),
+                                             WindowSimd_Splat(WindowList_NormalMapped)));
+    candidate = WindowSimd_AndNot(WindowSimd_Eq(index, WindowSimd_Splat(from)), candidate);
+
+    // Extents saturate at 0xFFFF unsigned, the clamp to INT16_MAX goes through the sign bit
+    WindowSimd bias    = WindowSimd_Splat(0x8000);
+    WindowSimd borders = WindowSimd_Load(&array->borders[i]);
+    borders            = WindowSimd_AddSatU(borders, borders);
+    WindowSimd along_extent =
+        WindowSimd_SubSat(WindowSimd_AddSatU(WindowSimd_AddSatU(WindowSimd_Load(&along_sizes[i]),
+                                                                borders),
+                                             bias),
+                          bias);
+    WindowSimd across_extent =
+        WindowSimd_SubSat(WindowSimd_AddSatU(WindowSimd_AddSatU(WindowSimd_Load(&across_sizes[i]),
+                                                                borders),
+                                             bias),
+                          bias);
+
+    WindowSimd start = WindowSimd_Load(&alongs[i]);
+    if (query.backward)
+    {
+      start = WindowSimd_SubSat(zero, WindowSimd_AddSat(start, along_extent));
+    }
+    candidate = WindowSimd_And(candidate, WindowSimd_Gt(start, WindowSimd_Splat(query.center)));
+
+    WindowSimd across     = WindowSimd_Load(&acrosses[i]);
+    WindowSimd across_end = WindowSimd_AddSat(across, across_extent);
+    WindowSimd overlap    = WindowSimd_And(WindowSimd_Gt(WindowSimd_Splat(query.perp_end), across),
+                                           WindowSimd_Gt(across_end,
+                                                         WindowSimd_Splat(query.perp_start)));
+    WindowSimd distance   = WindowSimd_SubSat(start, WindowSimd_Splat(query.end));
+    distance = WindowSimd_Min(WindowSimd_Max(distance, zero), WindowSimd_Splat(0x3FFE));
+    WindowSimd primary = WindowSimd_Or(distance, WindowSimd_AndNot(overlap,
+                                                                   WindowSimd_Splat(0x4000)));
+    WindowSimd offset  = WindowSimd_SubSat(WindowSimd_AddSat(across,
+                                                             WindowSimd_Half(across_extent)),
+                                           WindowSimd_Splat(query.perp_center));
+    WindowSimd secondary = WindowSimd_Min(WindowSimd_Max(offset, WindowSimd_SubSat(zero, offset)),
+                                          WindowSimd_Splat(0x7FFE));
+    primary              = WindowSimd_Select(candidate, primary, none);
+    secondary            = WindowSimd_Select(candidate, secondary, none);
+
+    // Ties keep the lower index, each lane only ever sees increasing ones
+    WindowSimd better =
+        WindowSimd_Or(WindowSimd_Gt(lanes_primary, primary),
+                      WindowSimd_And(WindowSimd_Eq(lanes_primary, primary),
+                                     WindowSimd_Gt(lanes_secondary, secondary)));
+    lanes_primary   = WindowSimd_Select(better, primary, lanes_primary);
+    lanes_secondary = WindowSimd_Select(better, secondary, lanes_secondary);
+    lanes_index     = WindowSimd_Select(better, index, lanes_index);
+  }
+  u16 primaries[WINDOW_SIMD_WIDTH];
+  u16 secondaries[WINDOW_SIMD_WIDTH];
+  u16 indices[WINDOW_SIMD_WIDTH];
+  WindowSimd_Store(primaries, lanes_primary);
+  WindowSimd_Store(secondaries, lanes_secondary);
+  WindowSimd_Store(indices, lanes_index);
+  for (u32 lane = 0; lane < WINDOW_SIMD_WIDTH; lane += 1)
+  {
+    i16 primary   = (i16)primaries[lane];
+    i16 secondary = (i16)secondaries[lane];
+    if (primary != 0x7FFF &&
+        (primary < best_primary || (primary == best_primary && secondary < best_secondary) ||
+         (primary == best_primary && secondary == best_secondary && indices[lane] < res)))
+    {
+      res            = indices[lane];
+      best_primary   = primary;
+      best_secondary = secondary;
+    }
+  }
+#endif
+  // Indices past the vectors are higher, a tie never replaces what the lanes found
+  for (; i < array->size; i += 1)
+  {
+    i16 primary;
+    i16 secondary;
+    if (WindowNearestScore(array, &query, i, &primary, &secondary) &&
+        (primary < best_primary || (primary == best_primary && secondary < best_secondary)))
+    {
+      res            = i;
+      best_primary   = primary;
+      best_secondary = secondary;
+    }
+  }
+#ifdef DEBUG_BUILD
+  Assert(res == WindowsSystemNearestScalar(array, from, direction));
+#endif
+  return res;
 }
\ No newline at end of file
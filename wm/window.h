@@ -2,6 +2,7 @@
 #define WM_WINDOW_H
 
 #include "../core/core.h"
+#include "config.h"
 #include <xcb/xproto.h>
 
 typedef enum : u8
@@ -11,22 +12,146 @@ typedef enum : u8
   WindowType_Docked   = 2,
 } WindowType;
 
+/*
+Lists a workspace keeps its windows in, the mapped and unmapped list of each WindowType in
+WindowType order, so a window's mapped list is its type times 2 and the unmapped one follows
+*/
+typedef enum : u8
+{
+  WindowList_NormalMapped     = 0,
+  WindowList_NormalUnmapped   = 1,
+  WindowList_FloatingMapped   = 2,
+  WindowList_FloatingUnmapped = 3,
+  WindowList_DockedMapped     = 4,
+  WindowList_DockedUnmapped   = 5,
+  WindowList_Count,
+  // In no workspace
+  WindowList_None = WindowList_Count,
+} WindowList;
+
+typedef struct
+{
+  i16 x;
+  i16 y;
+  u16 width;
+  u16 height;
+} Rect;
+
+/*
+Window id to its index in the WindowsSystem columns, X never hands out window 0
+*/
+internal u64  WindowIndexHash(xcb_window_t id, u64 max);
+internal bool WindowIndexKeyEquals(xcb_window_t lhs, xcb_window_t rhs);
+internal bool WindowIndexKeyIsEmpty(xcb_window_t id);
+
+EmptyKeyValueFuncTemplate(u32, u16);
+HashMapTemplateFull(u32, u16, WindowIndexMap, WindowIndexMap_, WindowIndexHash,
+                    WindowIndexKeyEquals, WindowIndexKeyIsEmpty, EmptyKeyValueDefault_u32_u16, u64);
+
+typedef struct
+{
+  u16 index;
+  // XCB_CONFIG_WINDOW_X, Y, WIDTH, HEIGHT and BORDER_WIDTH bits of the fields that differ
+  u16 value_mask;
+} WindowGeometryChange;
+
+/*
+The focused window's side of a nearest search. For left and up the along axis is mirrored, so
+every direction looks for windows that start past the center.
+*/
+typedef struct
+{
+  u16  from;
+  u16  monitor;
+  u16  workspace;
+  bool vertical;
+  bool backward;
+  // Along the direction
+  i16  center;
+  i16  end;
+  // Across it
+  i16  perp_start;
+  i16  perp_end;
+  i16  perp_center;
+} WindowNearestQuery;
+
 typedef struct
 {
-  xcb_window_t *ids;
-  i16          *xs;
-  i16          *ys;
-  u16          *widths;
-  u16          *heights;
-  WindowType   *window_types;
-  u16           size;
-  u16           capacity;
+  xcb_window_t   *ids;
+  i16            *xs;
+  i16            *ys;
+  u16            *widths;
+  u16            *heights;
+  u16            *borders;
+  // x the layout gave the window, kept here while its workspace is hidden and xs is parked
+  i16            *shown_xs;
+  // Geometry last sent to the server, or reported by it when the window was mapped
+  i16            *sent_xs;
+  i16            *sent_ys;
+  u16            *sent_widths;
+  u16            *sent_heights;
+  u16            *sent_borders;
+  WindowType     *window_types;
+  StrId          *class_names;
+  StrId          *instance_names;
+  // Where the window was placed, the workspace of the launch that created it if known
+  u16            *monitors;
+  u16            *workspaces;
+  // Membership, the list of that workspace the window is in and its position there
+  WindowList     *lists;
+  u16            *positions;
+  // Kept in step with ids by Push and UnorderedRemove
+  WindowIndexMap  indices;
+  u16             size;
+  u16             capacity;
 } WindowsSystem;
 
 internal WindowsSystem   WindowsSystemInit(Allocator allocator, u16 capacity);
 internal void            WindowsSystemDeinit(Allocator allocator, WindowsSystem *array);
+/*
+The geometry is what the server has, it is both the desired and the last sent geometry until
+something changes it
+*/
 internal AllocationError WindowsSystemPush(Allocator allocator, WindowsSystem *array,
                                            xcb_window_t id, i16 x, i16 y, u16 width, u16 height);
 internal void            WindowsSystemUnorderedRemove(WindowsSystem *array, u16 index);
+/*
+Index of the window in the columns, -1 if it isn't managed
+*/
+internal i32             WindowsSystemFind(WindowsSystem *array, xcb_window_t id);
+/*
+Diffs the desired geometry columns against the sent ones from *from on, 16 windows per AVX2
+compare, 8 with SSE2. Writes the windows that differ to changes and advances *from past them.
+A result equal to capacity means more may be waiting, call again.
+Example:
+  WindowGeometryChange changes[64];
+  u16                  from = 0;
+  u16                  count;
+  do
+  {
+    count = WindowsSystemGeometryChanges(&windows, &from, changes, 64);
+    for (u16 i = 0; i < count; i += 1)
+    {
+      // Send changes[i].value_mask fields, then
+      WindowsSystemMarkSent(&windows, changes[i].index);
+    }
+  } while (count == 64);
+*/
+internal u16             WindowsSystemGeometryChanges(WindowsSystem *array, u16 *from,
+                                                      WindowGeometryChange *changes,
+                                                      u16                   capacity);
+internal void            WindowsSystemMarkSent(WindowsSystem *array, u16 index);
+/*
+Index of the nearest mapped normal window in the direction on from's monitor and workspace, -1
+if there is none. Windows that overlap from across the direction come first, by distance along
+it, then by how far their centers are apart across it. Scores 16 windows per AVX2 compare, 8
+with SSE2, distances are capped at 0x3FFE pixels.
+*/
+internal i32             WindowsSystemNearest(WindowsSystem *array, u16 from, Direction direction);
+/*
+Same result one window at a time, debug builds check the lanes against it
+*/
+internal i32             WindowsSystemNearestScalar(WindowsSystem *array, u16 from,
+                                                    Direction direction);
 
 #endif
\ No newline at end of file
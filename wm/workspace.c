@@ -1 +1,350 @@
-#include "workspace.h"
\ No newline at end of file
+#include "workspace.h"
+
+internal Workspace WorkspaceInit(u16 id, Rect monitor_available_space)
+{
+  Workspace res               = {0};
+  res.id                      = id;
+  res.available_space         = monitor_available_space;
+  res.monitor_available_space = monitor_available_space;
+  res.bsp                     = BspInit();
+  return res;
+}
+
+internal void WorkspaceDeinit(Allocator allocator, Workspace *workspace)
+{
+  for (u32 list = 0; list < WindowList_Count; list += 1)
+  {
+    ArrayWindowId_Deinit(allocator, &workspace->lists[list]);
+  }
+  BspDeinit(allocator, &workspace->bsp);
+  ArrayBspIndex_Deinit(allocator, &workspace->leaves);
+}
+
+internal void WorkspaceMarkDirty(Workspace *workspace, u64 from)
+{
+  workspace->dirty_from = workspace->dirty ? Min(workspace->dirty_from, from) : from;
+  workspace->dirty      = true;
+}
+
+internal void WorkspaceInvalidate(Workspace *workspace)
+{
+  WorkspaceMarkDirty(workspace, 0);
+  workspace->column_width = 0;
+  BspInvalidate(&workspace->bsp);
+}
+
+internal AllocationError WorkspaceAddWindow(Allocator allocator, Workspace *workspace,
+                                            WindowsSystem *windows, u16 index, WindowList list)
+{
+  xcb_window_t    id    = windows->ids[index];
+  ArrayWindowId  *tiled = &workspace->normal_mapped_windows;
+  AllocationError res   = AllocationError_None;
+  if (list == WindowList_NormalMapped && workspace->layout == LayoutKind_Bsp)
+  {
+    u16 focused = workspace->focused < tiled->size ? workspace->leaves.data[workspace->focused]
+                                                   : BSP_NONE;
+    u16 leaf    = BspInsert(allocator, &workspace->bsp, focused, id);
+    res         = leaf == BSP_NONE ? AllocationError_OutOfMemory
+                                   : ArrayBspIndex_Push(allocator, &workspace->leaves, leaf);
+  }
+  if (res == AllocationError_None)
+  {
+    res = ArrayWindowId_Push(allocator, &workspace->lists[list], id);
+  }
+  if (res == AllocationError_None)
+  {
+    windows->workspaces[index] = workspace->id;
+    windows->lists[index]      = list;
+    windows->positions[index]  = (u16)(workspace->lists[list].size - 1);
+    if (list == WindowList_NormalMapped)
+    {
+      WorkspaceMarkDirty(workspace, tiled->size - 1);
+      // New windows take the focus
+      workspace->focused = tiled->size - 1;
+    }
+    // Mapped off-screen, it shows up with its workspace
+    if (workspace->hidden &&
+        (list == WindowList_NormalMapped || list == WindowList_FloatingMapped))
+    {
+      WorkspaceParkWindow(windows, index);
+    }
+  }
+  return res;
+}
+
+internal void WorkspaceFocus(Workspace *workspace, u64 position)
+{
+  u64 count          = workspace->normal_mapped_windows.size;
+  workspace->focused = count == 0 ? 0 : Min(position, count - 1);
+  WorkspaceMarkDirty(workspace, count);
+}
+
+internal xcb_window_t WorkspaceFocusedWindow(Workspace *workspace)
+{
+  ArrayWindowId *tiled = &workspace->normal_mapped_windows;
+  return workspace->focused < tiled->size ? tiled->data[workspace->focused] : 0;
+}
+
+internal bool WorkspaceResize(Workspace *workspace, Axis axis, i32 amount)
+{
+  bool res = false;
+  // Columns all share one width, there is no single column to grow
+  if (workspace->layout == LayoutKind_Bsp &&
+      workspace->focused < workspace->normal_mapped_windows.size)
+  {
+    res = BspResize(&workspace->bsp, workspace->leaves.data[workspace->focused], axis, amount);
+    if (res)
+    {
+      WorkspaceMarkDirty(workspace, workspace->normal_mapped_windows.size);
+    }
+  }
+  return res;
+}
+
+internal i16 WorkspaceParkedX(u16 width, u16 border)
+{
+  return (i16)Max(-((i32)width + 2 * (i32)border), INT16_MIN);
+}
+
+internal void WorkspaceParkWindow(WindowsSystem *windows, i32 index)
+{
+  if (index != -1)
+  {
+    windows->shown_xs[index] = windows->xs[index];
+    windows->xs[index]       = WorkspaceParkedX(windows->widths[index], windows->borders[index]);
+  }
+}
+
+internal void WorkspaceHide(Workspace *workspace, WindowsSystem *windows)
+{
+  ProfileZone("WorkspaceHide");
+  ArrayWindowId *shown[] = {&workspace->normal_mapped_windows, &workspace->floating_mapped_windows};
+  if (!workspace->hidden)
+  {
+    for (u64 l = 0; l < sizeof(shown) / sizeof(shown[0]); l += 1)
+    {
+      for (u64 i = 0; i < shown[l]->size; i += 1)
+      {
+        WorkspaceParkWindow(windows, WindowsSystemFind(windows, shown[l]->data[i]));
+      }
+    }
+    workspace->hidden = true;
+  }
+}
+
+internal void WorkspaceShow(Workspace *workspace, WindowsSystem *windows)
+{
+  ProfileZone("WorkspaceShow");
+  ArrayWindowId *shown[] = {&workspace->normal_mapped_windows, &workspace->floating_mapped_windows};
+  if (workspace->hidden)
+  {
+    for (u64 l = 0; l < sizeof(shown) / sizeof(shown[0]); l += 1)
+    {
+      for (u64 i = 0; i < shown[l]->size; i += 1)
+      {
+        i32 index = WindowsSystemFind(windows, shown[l]->data[i]);
+        if (index != -1)
+        {
+          windows->xs[index] = windows->shown_xs[index];
+        }
+      }
+    }
+    workspace->hidden = false;
+  }
+}
+
+internal bool WorkspaceRemoveWindow(Workspace *workspace, WindowsSystem *windows, u16 index)
+{
+  WindowList list = windows->lists[index];
+  u16        i    = windows->positions[index];
+  bool       res  = list != WindowList_None && windows->workspaces[index] == workspace->id;
+  if (res)
+  {
+    ArrayWindowId *from = &workspace->lists[list];
+    if (list == WindowList_NormalMapped)
+    {
+      // Tiling order is layout order, the columns after it shift left
+      ArrayWindowId_OrderedRemove(from, i);
+      for (u64 after = i; after < from->size; after += 1)
+      {
+        windows->positions[WindowsSystemFind(windows, from->data[after])] = (u16)after;
+      }
+      if (workspace->layout == LayoutKind_Bsp)
+      {
+        BspRemove(&workspace->bsp, workspace->leaves.data[i]);
+        ArrayBspIndex_OrderedRemove(&workspace->leaves, i);
+      }
+      WorkspaceMarkDirty(workspace, i);
+      // Focus stays on its window, from a removed one it passes to the window taking its place,
+      // or to its left neighbour if it was the last
+      if (workspace->focused > i || (workspace->focused == i && i == from->size && i != 0))
+      {
+        workspace->focused -= 1;
+      }
+    }
+    else
+    {
+      ArrayWindowId_UnorderedRemove(from, i);
+      if (i < from->size)
+      {
+        windows->positions[WindowsSystemFind(windows, from->data[i])] = i;
+      }
+    }
+    windows->lists[index]     = WindowList_None;
+    windows->positions[index] = 0;
+  }
+  return res;
+}
+
+internal AllocationError WorkspaceMoveWindow(Allocator allocator, Workspace *workspace,
+                                             WindowsSystem *windows, u16 index, WindowList list)
+{
+  AllocationError res = AllocationError_None;
+  if (windows->lists[index] != list)
+  {
+    WorkspaceRemoveWindow(workspace, windows, index);
+    res = WorkspaceAddWindow(allocator, workspace, windows, index, list);
+  }
+  return res;
+}
+
+/*
+Available space less the outer gaps
+*/
+internal Rect WorkspaceArea(Workspace *workspace, const StyleConfig *style)
+{
+  i32  width  = (i32)workspace->available_space.width - 2 * (i32)style->outer_gap_horizontal;
+  i32  height = (i32)workspace->available_space.height - 2 * (i32)style->outer_gap_vertical;
+  Rect res    = {0};
+  res.x       = (i16)(workspace->available_space.x + (i32)style->outer_gap_horizontal);
+  res.y       = (i16)(workspace->available_space.y + (i32)style->outer_gap_vertical);
+  res.width   = (u16)Clamp(1, width, UINT16_MAX);
+  res.height  = (u16)Clamp(1, height, UINT16_MAX);
+  return res;
+}
+
+/*
+Geometry of the column at the position in the strip, parked when it's outside the viewport
+*/
+internal void WorkspaceLayoutColumn(Workspace *workspace, WindowsSystem *windows, u64 position,
+                                    Rect area, i32 column_width, i32 remainder, i32 gap,
+                                    i32 border, i32 scroll)
+{
+  i32 index = WindowsSystemFind(windows, workspace->normal_mapped_windows.data[position]);
+  if (index != -1)
+  {
+    i32 strip_x = (i32)position * (column_width + gap) + Min((i32)position, remainder);
+    i32 span    = column_width + ((i32)position < remainder);
+    u16 width   = (u16)Clamp(1, span - 2 * border, UINT16_MAX);
+    i32 x       = area.x + strip_x - scroll;
+    if (strip_x + span <= scroll || strip_x >= scroll + area.width)
+    {
+      x = WorkspaceParkedX(width, (u16)border);
+    }
+    windows->xs[index]      = (i16)Clamp(INT16_MIN, x, INT16_MAX);
+    windows->ys[index]      = area.y;
+    windows->widths[index]  = width;
+    windows->heights[index] = (u16)Clamp(1, (i32)area.height - 2 * border, UINT16_MAX);
+  }
+}
+
+internal u64 WorkspaceLayout(Allocator allocator, Workspace *workspace, const StyleConfig *style,
+                             WindowsSystem *windows)
+{
+  ProfileZone("WorkspaceLayout");
+  ArrayWindowId *tiled = &workspace->normal_mapped_windows;
+  u64            res   = 0;
+  if (!workspace->hidden && style->layout != workspace->layout)
+  {
+    // The tree is built again from the tiling order, each window splitting the one before it
+    BspReset(&workspace->bsp);
+    workspace->leaves.size = 0;
+    if (style->layout == LayoutKind_Bsp)
+    {
+      u16 leaf = BSP_NONE;
+      for (u64 i = 0; i < tiled->size; i += 1)
+      {
+        leaf = BspInsert(allocator, &workspace->bsp, leaf, tiled->data[i]);
+        if (leaf == BSP_NONE ||
+            ArrayBspIndex_Push(allocator, &workspace->leaves, leaf) !=
+                AllocationError_None)
+        {
+          Errorf("Failed to build the BSP tree of workspace %d.", workspace->id);
+          break;
+        }
+      }
+    }
+    workspace->layout = style->layout;
+    workspace->scroll = 0;
+    WorkspaceInvalidate(workspace);
+  }
+  // Hidden workspaces keep the changes for when they are shown
+  bool due = workspace->dirty && !workspace->hidden;
+  if (due && workspace->layout == LayoutKind_Bsp)
+  {
+    res                   = BspLayout(&workspace->bsp, WorkspaceArea(workspace, style),
+                                      (i32)style->inner_gap, (i32)style->border_width, windows);
+    workspace->dirty      = false;
+    workspace->dirty_from = tiled->size;
+  }
+  else if (due)
+  {
+    i32  gap    = (i32)style->inner_gap;
+    i32  border = (i32)style->border_width;
+    Rect area   = WorkspaceArea(workspace, style);
+
+    i32 count        = (i32)tiled->size;
+    i32 column_width = Max((i32)(area.width * style->default_width_percent_available_width),
+                           (i32)style->minimum_width_tiling_window);
+    // Columns that fit share the width, the first ones take the pixels left over by the division
+    i32 remainder    = 0;
+    if (count > 0 && count * column_width + (count - 1) * gap <= area.width)
+    {
+      column_width = (area.width - (count - 1) * gap) / count;
+      remainder    = (area.width - (count - 1) * gap) % count;
+    }
+    column_width = Clamp(1, column_width, UINT16_MAX);
+
+    // Just enough scroll to show the whole focused column, none once the strip fits
+    i32 stride    = column_width + gap;
+    i32 strip     = count * stride - gap;
+    i32 focused_x = (i32)workspace->focused * stride;
+    i32 scroll    = Min(workspace->scroll, focused_x);
+    scroll        = Max(scroll, focused_x + column_width - (i32)area.width);
+    scroll        = Clamp(0, scroll, Max(strip - (i32)area.width, 0));
+
+    u64 from = workspace->dirty_from;
+    if (column_width != workspace->column_width || remainder != 0)
+    {
+      from = 0;
+    }
+    for (u64 i = from; i < tiled->size; i += 1)
+    {
+      WorkspaceLayoutColumn(workspace, windows, i, area, column_width, remainder, gap, border,
+                            scroll);
+    }
+    res = tiled->size - Min(from, tiled->size);
+    // Columns before the dirty span only change if they enter or leave the viewport, or stay in
+    // it and move
+    if (scroll != workspace->scroll && from != 0)
+    {
+      i32 scrolls[2] = {workspace->scroll, scroll};
+      for (u32 s = 0; s < 2; s += 1)
+      {
+        u64 first = (u64)(scrolls[s] / stride);
+        u64 last  = (u64)((scrolls[s] + (i32)area.width - 1) / stride);
+        for (u64 i = first; i <= last && i < from; i += 1)
+        {
+          WorkspaceLayoutColumn(workspace, windows, i, area, column_width, remainder, gap,
+                                border, scroll);
+          res += 1;
+        }
+      }
+    }
+    workspace->column_width = (u16)column_width;
+    workspace->scroll       = scroll;
+    workspace->dirty        = false;
+    workspace->dirty_from   = tiled->size;
+  }
+  return res;
+}
\ No newline at end of file
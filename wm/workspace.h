@@ -2,34 +2,128 @@
 #define WM_WORKSPACE_H
 
 #include "../core/core.h"
+#include "bsp.h"
+#include "config.h"
+#include "window.h"
 #include <xcb/xproto.h>
 
 ArrayTemplatePrefix(xcb_window_t, ArrayWindowId, ArrayWindowId_);
 
-typedef struct
-{
-  i16 x;
-  i16 y;
-  u16 width;
-  u16 height;
-} Rect;
-
 typedef struct
 {
   u16           id;
   Rect          available_space;
   Rect          monitor_available_space;
-  ArrayWindowId normal_mapped_windows;
-  ArrayWindowId normal_unmapped_windows;
-  ArrayWindowId floating_mapped_windows;
-  ArrayWindowId floating_unmapped_windows;
-  ArrayWindowId docked_mapped_windows;
-  ArrayWindowId docked_unmapped_windows;
+  // Allocated on the first push, a workspace never used holds no memory
+  union
+  {
+    ArrayWindowId lists[WindowList_Count];
+    struct
+    {
+      ArrayWindowId normal_mapped_windows;
+      ArrayWindowId normal_unmapped_windows;
+      ArrayWindowId floating_mapped_windows;
+      ArrayWindowId floating_unmapped_windows;
+      ArrayWindowId docked_mapped_windows;
+      ArrayWindowId docked_unmapped_windows;
+    };
+  };
+  // Tiled windows from dirty_from on, in normal_mapped_windows order, need new geometry
+  bool          dirty;
+  u64           dirty_from;
+  // Width every column got in the last layout pass, when it changes every column moves
+  u16           column_width;
+  // Position of the focused window in normal_mapped_windows
+  u64           focused;
+  // Left edge of the viewport over the column strip as of the last layout pass
+  i32           scroll;
+  // Layout of the last pass, the tree is only kept while it is LayoutKind_Bsp
+  LayoutKind    layout;
+  BspTree       bsp;
+  // Leaf of every window in normal_mapped_windows, same order
+  ArrayBspIndex leaves;
+  // Not shown on its monitor, its windows are parked and it isn't laid out until it is shown
+  bool          hidden;
 } Workspace;
 
-internal Workspace WorkspaceInit(Allocator allocator, u16 id, Rect monitor_available_space);
+internal Workspace WorkspaceInit(u16 id, Rect monitor_available_space);
 internal void      WorkspaceDeinit(Allocator allocator, Workspace *workspace);
-internal void WorkspaceAddFloatingWindow(Allocator allocator, Workspace *workspace, xcb_window_t id,
-                                         Rect hint_rect);
+/*
+Appends the window at index in the WindowsSystem to the list and records the membership in the
+lists, positions and workspaces columns. A tiled window goes after the others and takes the
+focus, only its column needs geometry unless the columns were sharing the width.
+*/
+internal AllocationError WorkspaceAddWindow(Allocator allocator, Workspace *workspace,
+                                            WindowsSystem *windows, u16 index, WindowList list);
+/*
+Takes the window out of the list its membership record names, no search. Every list but the
+tiled one swaps its last window into the hole. Tiled windows are in layout order, the ones
+after it shift left and are laid out again anyway. False if this workspace doesn't hold it.
+*/
+internal bool            WorkspaceRemoveWindow(Workspace *workspace, WindowsSystem *windows,
+                                               u16 index);
+/*
+Moves the window to another list of the workspace, mapped to unmapped and back
+*/
+internal AllocationError WorkspaceMoveWindow(Allocator allocator, Workspace *workspace,
+                                             WindowsSystem *windows, u16 index, WindowList list);
+internal void            WorkspaceMarkDirty(Workspace *workspace, u64 from);
+/*
+Focuses the tiled window at the position, clamped to the last one. The viewport follows on the
+next layout pass.
+*/
+internal void            WorkspaceFocus(Workspace *workspace, u64 position);
+/*
+Focused tiled window, 0 if there is none
+*/
+internal xcb_window_t    WorkspaceFocusedWindow(Workspace *workspace);
+/*
+Grows the focused window by amount pixels along the axis, false if the layout can't
+*/
+internal bool            WorkspaceResize(Workspace *workspace, Axis axis, i32 amount);
+/*
+Style or available space changed, everything is laid out again
+*/
+internal void            WorkspaceInvalidate(Workspace *workspace);
+/*
+Parks every mapped tiled and floating window just left of the root window, the x it had is kept
+in shown_xs. Moving the windows away instead of unmapping them spares the clients a repaint when
+they come back.
+*/
+internal void            WorkspaceHide(Workspace *workspace, WindowsSystem *windows);
+/*
+Puts the windows back where the last layout pass left them, only what changed while the
+workspace was hidden is laid out again
+*/
+internal void            WorkspaceShow(Workspace *workspace, WindowsSystem *windows);
+/*
+Parks a single window, WorkspaceAddWindow does it for windows added to a hidden workspace
+*/
+internal void            WorkspaceParkWindow(WindowsSystem *windows, i32 index);
+
+/*
+Lays out the tiled windows with style->layout, switching the workspace over to it first if the
+last pass used another one.
+Columns: full height columns left to right over the available space, less the outer gaps,
+inner_gap apart. While default_width_percent_available_width columns, never narrower than
+minimum_width_tiling_window, fit, they share the width instead. Past that every column gets that
+width and the viewport scrolls over the strip just enough to show the whole focused column.
+Columns outside the viewport are parked left of the root window at a spot that doesn't depend
+on the scroll, so a scroll leaves them unchanged and the geometry diff sends them nothing.
+Every column depends only on its position, the column width and the scroll. Structural changes
+compute the dirty span again, a scroll only the columns visible before or after it.
+BSP: new windows split the focused one, see BspTree for what a change recomputes.
+Geometry goes straight into the WindowsSystem columns as X geometry, the border excluded.
+A change of the configured layout rebuilds the workspace for it, allocating from the allocator.
+Hidden workspaces are skipped and stay dirty until shown.
+Returns the number of windows whose geometry was computed again.
+*/
+internal u64 WorkspaceLayout(Allocator allocator, Workspace *workspace, const StyleConfig *style,
+                             WindowsSystem *windows);
+
+/*
+x that puts a window of that size, border included, just left of the root window
+*/
+internal i16 WorkspaceParkedX(u16 width, u16 border);
 
 #endif
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include "monitor.h"
 #include "randr.h"
 #include "workspace.h"
+#include "journal.h"
+#include "keyboard.h"
+#include "launcher.h"
 
 #include <X11/Xlib.h>
 #include <X11/Xlib-xcb.h>
@@ -19,12 +22,29 @@ xcb_connection_t     *g_conn;
 xcb_screen_t         *g_screen;
 xcb_ewmh_connection_t g_ewmh;
 int                   g_randr_base;
+// -1 when the server has no XKB
+int                   g_xkb_base = -1;
+// Class, instance and monitor names, compared by id instead of by bytes
+StrInternTable        g_strings;
+// Frames reset the main arena, managed windows have to outlive them
+Arena                *g_windows_arena;
+WindowsSystem         g_windows;
+// Last applied config snapshot
+const Config         *g_config;
+XcbRequestCounters    g_config_requests;
+// (keycode, modifiers) to index + 1 into the applied snapshot's bindings, 0 when unbound
+u32                   g_key_table[256][16];
+// Holds the input focus and the active border color, 0 for none
+xcb_window_t          g_focused_window;
 
 internal bool EwmhInit()
 {
   bool                      ok           = true;
   xcb_intern_atom_cookie_t *ewmh_cookies = xcb_ewmh_init_atoms(g_conn, &g_ewmh);
-  if (!xcb_ewmh_init_atoms_replies(&g_ewmh, ewmh_cookies, NULL))
+  TraceBegin("xcb_ewmh_init_atoms_replies");
+  u8 atoms_ok = xcb_ewmh_init_atoms_replies(&g_ewmh, ewmh_cookies, NULL);
+  TraceEnd();
+  if (!atoms_ok)
   {
     Error("Failed to initialize EWMH atoms.");
     ok = false;
@@ -62,7 +82,11 @@ internal bool EwmhInit()
     };
     xcb_void_cookie_t cookie = xcb_ewmh_set_supported_checked(
         &g_ewmh, 0, sizeof(net_atoms) / sizeof(xcb_atom_t), net_atoms);
+    TraceFlowStart("ChangeProperty", cookie.sequence);
+    TraceBegin("xcb_request_check");
     xcb_generic_error_t *error = xcb_request_check(g_conn, cookie);
+    TraceFlowEnd("ChangeProperty", cookie.sequence);
+    TraceEnd();
     if (error)
     {
       Errorf("Failed set supported ewmh atoms, error_code: %d, major_code: %d, minor_code: %d",
@@ -111,14 +135,21 @@ internal bool Xcb_Init(Allocator allocator, String wm_name)
 
     ok = EwmhInit();
   }
+  if (ok && !KeyboardInit(g_conn, &g_xkb_base))
+  {
+    Error("Failed to get the keyboard mapping, no key will be grabbed");
+  }
   if (ok)
   {
+    g_strings       = StrInternTableInit(Megabytes(64));
+    g_windows_arena = ArenaInit(Megabytes(64));
+    g_windows       = WindowsSystemInit(ArenaAllocator(g_windows_arena), 64);
     if (!RandrInit(allocator, g_conn, g_screen->root, &g_randr_base))
     {
       Error(
           "Failed to init monitors from randr, fallback to getting required info from the screen");
-      AddMonitor(allocator, StrLit("default"), true, 0, 0, 0, g_screen->width_in_pixels,
-                 g_screen->height_in_pixels);
+      AddMonitor(allocator, StrIntern(&g_strings, StrLit("default")), true, 0, 0, 0,
+                 g_screen->width_in_pixels, g_screen->height_in_pixels);
     }
   }
   xcb_flush(g_conn);
@@ -128,8 +159,18 @@ internal bool Xcb_Init(Allocator allocator, String wm_name)
 internal void Xcb_Deinit()
 {
   xcb_ungrab_pointer(g_conn, XCB_CURRENT_TIME);
+  KeyboardDeinit();
   xcb_disconnect(g_conn);
   XCloseDisplay(g_display);
+  StrInternTableDeinit(&g_strings);
+  ArenaDeinit(g_windows_arena);
+  g_windows_arena = NULL;
+}
+
+internal int Xcb_Flush()
+{
+  xcb_flush(g_conn);
+  return xcb_get_file_descriptor(g_conn);
 }
 
 internal void Xcb_ChangeWindowAttributes(xcb_window_t window, int value_mask, int value)
@@ -143,7 +184,12 @@ internal WindowType Xcb_WindowType(xcb_window_t window)
   WindowType                 window_type = WindowType_Normal;
   xcb_get_property_cookie_t  cookie      = xcb_ewmh_get_wm_window_type(&g_ewmh, window);
   xcb_ewmh_get_atoms_reply_t window_type_atoms;
-  if (xcb_ewmh_get_wm_window_type_reply(&g_ewmh, cookie, &window_type_atoms, NULL))
+  TraceFlowStart("GetProperty", cookie.sequence);
+  TraceBegin("xcb_ewmh_get_wm_window_type_reply");
+  u8 got_reply = xcb_ewmh_get_wm_window_type_reply(&g_ewmh, cookie, &window_type_atoms, NULL);
+  TraceFlowEnd("GetProperty", cookie.sequence);
+  TraceEnd();
+  if (got_reply)
   {
     for (u32 i = 0; i < window_type_atoms.atoms_len; i += 1)
     {
@@ -171,8 +217,209 @@ internal WindowType Xcb_WindowType(xcb_window_t window)
   return window_type;
 }
 
+/*
+Returns XCB_NONE for events which are not about a particular window
+*/
+internal xcb_window_t Xcb_EventWindow(xcb_generic_event_t *event)
+{
+  xcb_window_t res = XCB_NONE;
+  switch (event->response_type & ~0x80)
+  {
+  case XCB_MAP_REQUEST:
+    res = ((xcb_map_request_event_t *)event)->window;
+    break;
+  case XCB_UNMAP_NOTIFY:
+    res = ((xcb_unmap_notify_event_t *)event)->window;
+    break;
+  case XCB_DESTROY_NOTIFY:
+    res = ((xcb_destroy_notify_event_t *)event)->window;
+    break;
+  case XCB_CONFIGURE_REQUEST:
+    res = ((xcb_configure_request_event_t *)event)->window;
+    break;
+  case XCB_PROPERTY_NOTIFY:
+    res = ((xcb_property_notify_event_t *)event)->window;
+    break;
+  case XCB_CLIENT_MESSAGE:
+    res = ((xcb_client_message_event_t *)event)->window;
+    break;
+  case XCB_ENTER_NOTIFY:
+    res = ((xcb_enter_notify_event_t *)event)->event;
+    break;
+  }
+  return res;
+}
+
+internal u32 Xcb_PixelFromColor(Vec3 color)
+{
+  return ((u32)color.x << 16) | ((u32)color.y << 8) | (u32)color.z;
+}
+
+/*
+Returns -1 for windows that are not managed
+*/
+internal i32 Xcb_FindManagedWindow(xcb_window_t window)
+{
+  return WindowsSystemFind(&g_windows, window);
+}
+
+/*
+Moves the input focus and the active border color, 0 gives the focus back to the root window
+*/
+internal void Xcb_FocusWindow(xcb_window_t window)
+{
+  if (g_config && window != g_focused_window)
+  {
+    if (g_focused_window != 0)
+    {
+      Xcb_ChangeWindowAttributes(g_focused_window, XCB_CW_BORDER_PIXEL,
+                                 Xcb_PixelFromColor(g_config->style.border_default_color));
+    }
+    if (window != 0)
+    {
+      Xcb_ChangeWindowAttributes(window, XCB_CW_BORDER_PIXEL,
+                                 Xcb_PixelFromColor(g_config->style.border_active_color));
+    }
+    xcb_set_input_focus(g_conn, XCB_INPUT_FOCUS_POINTER_ROOT,
+                        window != 0 ? window : XCB_INPUT_FOCUS_POINTER_ROOT, XCB_CURRENT_TIME);
+    xcb_ewmh_set_active_window(&g_ewmh, 0, window != 0 ? window : XCB_WINDOW_NONE);
+    g_focused_window = window;
+  }
+}
+
+/*
+Workspace shown on the active monitor
+*/
+internal Workspace *Xcb_ActiveWorkspace()
+{
+  u16 monitor = MonitorActive();
+  return MonitorWorkspace(ArenaAllocator(g_windows_arena), monitor,
+                          MonitorActiveWorkspace(monitor));
+}
+
+/*
+Shift, Control, Mod1 and Mod4 packed into the 4 bits indexing the key table, lock modifiers
+are left out
+*/
+internal u32 Xcb_KeyTableModifiers(u16 state)
+{
+  return ((state & XCB_MOD_MASK_SHIFT) ? 1u : 0u) | ((state & XCB_MOD_MASK_CONTROL) ? 2u : 0u) |
+         ((state & XCB_MOD_MASK_1) ? 4u : 0u) | ((state & XCB_MOD_MASK_4) ? 8u : 0u);
+}
+
+/*
+Rebuilt from the applied snapshot and after every mapping change, keycodes come from the
+keyboard module's table so this is no round trip per binding
+*/
+internal void Xcb_BuildKeyTable()
+{
+  ProfileZone("Xcb_BuildKeyTable");
+  memset(g_key_table, 0, sizeof g_key_table);
+  for (u64 i = 0; i < g_config->bindings.size; i += 1)
+  {
+    KeyBinding   *binding = &g_config->bindings.data[i];
+    xcb_keycode_t keycode = KeyboardKeycode(binding->keysym);
+    if (keycode != 0)
+    {
+      g_key_table[keycode][Xcb_KeyTableModifiers(binding->modifiers)] = (u32)i + 1;
+    }
+  }
+}
+
+/*
+Returns false when the binding asks the window manager to exit
+*/
+internal bool HandleKeyPress(xcb_key_press_event_t *event)
+{
+  ProfileZone("HandleKeyPress");
+  bool running = true;
+  u32  index   = g_key_table[event->detail][Xcb_KeyTableModifiers(event->state)];
+  if (g_config && index != 0)
+  {
+    KeyBinding *binding = &g_config->bindings.data[index - 1];
+    switch (binding->action.op)
+    {
+    case KeyActionOp_ExitWindowManager:
+      running = false;
+      break;
+    // Waiting on an exec from the event loop would freeze the window manager, both run detached
+    case KeyActionOp_Exec:
+    case KeyActionOp_ExecBackground:
+    {
+      u16 monitor = MonitorActive();
+      LauncherSpawn(KeyBindingCommand(g_config, binding), monitor,
+                    MonitorActiveWorkspace(monitor));
+      break;
+    }
+    // Left and right walk the column strip, the viewport follows in the same flush. Off-screen
+    // columns are parked, so there the strip order beats the geometry. Everything else goes to
+    // the nearest window in the direction by what the layout wrote into the columns.
+    case KeyActionOp_FocusWindow:
+    {
+      Workspace *workspace = Xcb_ActiveWorkspace();
+      Direction  direction = binding->action.arg.direction;
+      bool       moved     = false;
+      if (workspace && workspace->layout == LayoutKind_Columns)
+      {
+        if (direction == Direction_Left || direction == Direction_Right)
+        {
+          u64 focused = workspace->focused;
+          WorkspaceFocus(workspace, direction == Direction_Left ? focused - (focused != 0)
+                                                                : focused + 1);
+          moved = true;
+        }
+      }
+      else if (workspace)
+      {
+        xcb_window_t focused = WorkspaceFocusedWindow(workspace);
+        i32          from    = focused == 0 ? -1 : WindowsSystemFind(&g_windows, focused);
+        i32 nearest = from == -1 ? -1 : WindowsSystemNearest(&g_windows, (u16)from, direction);
+        if (nearest != -1)
+        {
+          WorkspaceFocus(workspace, g_windows.positions[nearest]);
+          moved = true;
+        }
+      }
+      if (moved)
+      {
+        Xcb_FocusWindow(WorkspaceFocusedWindow(workspace));
+        Xcb_Layout();
+        xcb_flush(g_conn);
+      }
+      break;
+    }
+    // Moves the nearest BSP split across the axis, the column layout has none
+    case KeyActionOp_WindowSizeChange:
+    {
+      Workspace *workspace = Xcb_ActiveWorkspace();
+      if (workspace && WorkspaceResize(workspace, binding->action.arg.resize.axis,
+                                       (i32)binding->action.arg.resize.amount))
+      {
+        Xcb_Layout();
+        xcb_flush(g_conn);
+      }
+      break;
+    }
+    // Bindings count workspaces from 1, the ids and the EWMH desktops from 0
+    case KeyActionOp_SwitchToWorkspace:
+      Xcb_SwitchToWorkspace((u16)(Max(binding->action.arg.workspace, 1) - 1));
+      break;
+    case KeyActionOp_MoveFocusedWindowToWorkspace:
+      Xcb_MoveFocusedWindowToWorkspace((u16)(Max(binding->action.arg.workspace, 1) - 1));
+      break;
+    default:
+      Debugf("Keymap: %s is not handled yet", KeyActionOpName(binding->action.op));
+      break;
+    }
+  }
+  return running;
+}
+
 internal void HandleMapRequest(xcb_map_request_event_t *event)
 {
+  ProfileZone("HandleMapRequest");
+  TraceBegin("HandleMapRequest");
+  u64 start = TimeNow();
   Debugf("handle map request for window %d", event->window);
   WindowType window_type = Xcb_WindowType(event->window);
   Debugf("window type: %d", window_type);
@@ -181,9 +428,21 @@ internal void HandleMapRequest(xcb_map_request_event_t *event)
       g_conn, 0, event->window, XCB_ATOM_WM_NORMAL_HINTS, XCB_GET_PROPERTY_TYPE_ANY, 0, 1024);
   xcb_get_property_cookie_t wm_class_cookie = xcb_get_property(
       g_conn, 0, event->window, XCB_ATOM_WM_CLASS, XCB_GET_PROPERTY_TYPE_ANY, 0, 1024);
+  // Sent with the others so placing the window by its launch costs no extra round trip
+  xcb_get_property_cookie_t pid_cookie = xcb_ewmh_get_wm_pid(&g_ewmh, event->window);
+  // What the server has is the starting point of the geometry diff
+  xcb_get_geometry_cookie_t geometry_cookie = xcb_get_geometry(g_conn, event->window);
 
+  TraceFlowStart("GetProperty", normal_hints_cookie.sequence);
+  TraceFlowStart("GetProperty", wm_class_cookie.sequence);
+  TraceFlowStart("GetProperty", pid_cookie.sequence);
+  TraceFlowStart("GetGeometry", geometry_cookie.sequence);
+
+  TraceBegin("xcb_get_property_reply");
   xcb_get_property_reply_t *normal_hints_reply =
       xcb_get_property_reply(g_conn, normal_hints_cookie, NULL);
+  TraceFlowEnd("GetProperty", normal_hints_cookie.sequence);
+  TraceEnd();
   if (!normal_hints_reply || normal_hints_reply->type != XCB_ATOM_WM_SIZE_HINTS)
   {
     Error("Failed to retrieve size hints");
@@ -196,32 +455,262 @@ internal void HandleMapRequest(xcb_map_request_event_t *event)
     Debugf("Program specified minimum size: %d by %d", size_hints->base_width,
            size_hints->base_height);
   }
+  free(normal_hints_reply);
 
+  StrId class_name    = StrId_None;
+  StrId instance_name = StrId_None;
+  TraceBegin("xcb_get_property_reply");
   xcb_get_property_reply_t *wm_class_reply = xcb_get_property_reply(g_conn, wm_class_cookie, NULL);
+  TraceFlowEnd("GetProperty", wm_class_cookie.sequence);
+  TraceEnd();
   if (!wm_class_reply || wm_class_reply->type != XCB_ATOM_STRING)
   {
     Error("Failed to retrieve wm class");
   }
   else
   {
-    String class_name = StrCstr((char *)xcb_get_property_value(wm_class_reply));
-    Debugf("class name: %.*s", StrFmtVal(class_name));
-    char  *instance_name_cstr = (char *)class_name.data + class_name.size + 1;
-    String instance_name      = StrCstr(instance_name_cstr);
-    Debugf("instance name: %.*s", StrFmtVal(instance_name));
+    // WM_CLASS holds two consecutive null-terminated strings: instance name, then class name
+    String value = Str(xcb_get_property_value(wm_class_reply),
+                       xcb_get_property_value_length(wm_class_reply));
+    i64    split = StrIndexByte(value, '\0');
+    if (split != -1)
+    {
+      String instance = StrSubstrTill(value, split);
+      String class    = StrSubstrFrom(value, split + 1);
+      i64    end      = StrIndexByte(class, '\0');
+      if (end != -1)
+      {
+        class = StrSubstrTill(class, end);
+      }
+      class_name    = StrIntern(&g_strings, class);
+      instance_name = StrIntern(&g_strings, instance);
+      Debugf("class name: %.*s (%u)", StrFmtVal(StrFromId(&g_strings, class_name)), class_name);
+      Debugf("instance name: %.*s (%u)", StrFmtVal(StrFromId(&g_strings, instance_name)),
+             instance_name);
+    }
   }
+  // Interning copied both names, the reply isn't referenced past this point
+  free(wm_class_reply);
 
-  xcb_map_window(g_conn, event->window);
+  // Windows land where they were launched from, anything else goes to the active workspace
+  u32          pid    = 0;
+  LaunchRecord launch = {.monitor = MonitorActive()};
+  launch.workspace    = MonitorActiveWorkspace(launch.monitor);
+  TraceBegin("xcb_ewmh_get_wm_pid_reply");
+  u8 pid_ok = xcb_ewmh_get_wm_pid_reply(&g_ewmh, pid_cookie, &pid, NULL);
+  TraceFlowEnd("GetProperty", pid_cookie.sequence);
+  TraceEnd();
+  if (pid_ok && pid > 1 && LauncherFindLaunch((i32)pid, &launch))
+  {
+    Debugf("window %d of pid %u launched on workspace %u of monitor %u", event->window, pid,
+           launch.workspace, launch.monitor);
+  }
+
+  TraceBegin("xcb_get_geometry_reply");
+  xcb_get_geometry_reply_t *geometry = xcb_get_geometry_reply(g_conn, geometry_cookie, NULL);
+  TraceFlowEnd("GetGeometry", geometry_cookie.sequence);
+  TraceEnd();
+  xcb_get_geometry_reply_t known = geometry ? *geometry : (xcb_get_geometry_reply_t){0};
+  free(geometry);
+
+  i32 managed = Xcb_FindManagedWindow(event->window);
+  if (managed == -1 &&
+      WindowsSystemPush(ArenaAllocator(g_windows_arena), &g_windows, event->window, known.x,
+                        known.y, known.width, known.height) == AllocationError_None)
+  {
+    u16 index                       = g_windows.size - 1;
+    g_windows.borders[index]        = known.border_width;
+    g_windows.sent_borders[index]   = known.border_width;
+    g_windows.window_types[index]   = window_type;
+    g_windows.class_names[index]    = class_name;
+    g_windows.instance_names[index] = instance_name;
+    g_windows.monitors[index]       = launch.monitor;
+    g_windows.workspaces[index]     = launch.workspace;
+    if (g_config && window_type != WindowType_Docked)
+    {
+      g_windows.borders[index] = (u16)g_config->style.border_width;
+      Xcb_ChangeWindowAttributes(event->window, XCB_CW_BORDER_PIXEL,
+                                 Xcb_PixelFromColor(g_config->style.border_default_color));
+    }
+    Workspace *workspace =
+        MonitorWorkspace(ArenaAllocator(g_windows_arena), launch.monitor, launch.workspace);
+    if (workspace)
+    {
+      WorkspaceAddWindow(ArenaAllocator(g_windows_arena), workspace, &g_windows, index,
+                         (WindowList)(window_type * 2));
+    }
+  }
+  else if (managed != -1 && g_windows.lists[managed] != WindowList_None)
+  {
+    // Mapped again after withdrawing itself, back into the mapped list of its workspace
+    Workspace *workspace = MonitorWorkspace(ArenaAllocator(g_windows_arena),
+                                            g_windows.monitors[managed],
+                                            g_windows.workspaces[managed]);
+    if (workspace)
+    {
+      WorkspaceMoveWindow(ArenaAllocator(g_windows_arena), workspace, &g_windows, (u16)managed,
+                          (WindowList)(g_windows.window_types[managed] * 2));
+    }
+  }
+
+  // Placed before it shows up, the client doesn't paint at the old size first
+  Xcb_Layout();
+  xcb_void_cookie_t map_cookie = xcb_map_window(g_conn, event->window);
+  JournalPush((JournalRecord){.start    = TimeNow(),
+                             .kind     = JournalKind_Request,
+                             .code     = XCB_MAP_WINDOW,
+                             .window   = event->window,
+                             .sequence = map_cookie.sequence});
+  Workspace *active = Xcb_ActiveWorkspace();
+  if (active && WorkspaceFocusedWindow(active) == event->window)
+  {
+    Xcb_FocusWindow(event->window);
+  }
   xcb_flush(g_conn);
+  JournalPush((JournalRecord){.start    = start,
+                             .duration = JournalSince(start),
+                             .kind     = JournalKind_Action,
+                             .code     = JournalAction_ManageWindow,
+                             .window   = event->window,
+                             .arg0     = window_type,
+                             .arg1     = launch.workspace});
+  TraceEnd();
+}
+
+internal void HandleMappingNotify(xcb_mapping_notify_event_t *event)
+{
+  ProfileZone("HandleMappingNotify");
+  if (KeyboardHandleMappingNotify(g_conn, g_screen->root, event) != 0 && g_config)
+  {
+    Xcb_BuildKeyTable();
+  }
+}
+
+/*
+Keymap, layout group and keyboard changes, the key table follows any keycode that moved
+*/
+internal void HandleXkbEvent(XkbEvent *event)
+{
+  ProfileZone("HandleXkbEvent");
+  if (KeyboardHandleXkbEvent(g_conn, g_screen->root, event) != 0 && g_config)
+  {
+    Xcb_BuildKeyTable();
+  }
+}
+
+/*
+Only clients withdraw windows, hidden workspaces park theirs without unmapping
+*/
+internal void HandleUnmapNotify(xcb_unmap_notify_event_t *event)
+{
+  ProfileZone("HandleUnmapNotify");
+  i32 index = Xcb_FindManagedWindow(event->window);
+  if (index != -1 && g_windows.lists[index] != WindowList_None)
+  {
+    Workspace *workspace = MonitorWorkspace(ArenaAllocator(g_windows_arena),
+                                            g_windows.monitors[index],
+                                            g_windows.workspaces[index]);
+    if (workspace)
+    {
+      WorkspaceMoveWindow(ArenaAllocator(g_windows_arena), workspace, &g_windows, (u16)index,
+                          (WindowList)(g_windows.window_types[index] * 2 + 1));
+      if (g_windows.ids[index] == g_focused_window && workspace == Xcb_ActiveWorkspace())
+      {
+        Xcb_FocusWindow(WorkspaceFocusedWindow(workspace));
+      }
+    }
+  }
+}
+
+internal void HandleDestroyNotify(xcb_destroy_notify_event_t *event)
+{
+  ProfileZone("HandleDestroyNotify");
+  i32 index = Xcb_FindManagedWindow(event->window);
+  if (index != -1)
+  {
+    Workspace *workspace = MonitorWorkspace(ArenaAllocator(g_windows_arena),
+                                            g_windows.monitors[index],
+                                            g_windows.workspaces[index]);
+    if (workspace)
+    {
+      WorkspaceRemoveWindow(workspace, &g_windows, (u16)index);
+    }
+    // The window is gone, there is no border left to recolor
+    if (g_windows.ids[index] == g_focused_window)
+    {
+      g_focused_window = 0;
+      if (workspace && workspace == Xcb_ActiveWorkspace())
+      {
+        Xcb_FocusWindow(WorkspaceFocusedWindow(workspace));
+      }
+    }
+    WindowsSystemUnorderedRemove(&g_windows, (u16)index);
+  }
+}
+
+/*
+Managed windows keep the geometry the layout gives them. Windows that aren't managed yet, which
+usually size themselves right before mapping, get the request passed on as is.
+*/
+internal void HandleConfigureRequest(xcb_configure_request_event_t *event)
+{
+  ProfileZone("HandleConfigureRequest");
+  if (Xcb_FindManagedWindow(event->window) == -1)
+  {
+    // Values go in the order of the mask bits
+    u16 mask = event->value_mask;
+    u32 values[7];
+    u32 count = 0;
+    if (mask & XCB_CONFIG_WINDOW_X)
+    {
+      values[count] = (u32)(i32)event->x;
+      count += 1;
+    }
+    if (mask & XCB_CONFIG_WINDOW_Y)
+    {
+      values[count] = (u32)(i32)event->y;
+      count += 1;
+    }
+    if (mask & XCB_CONFIG_WINDOW_WIDTH)
+    {
+      values[count] = event->width;
+      count += 1;
+    }
+    if (mask & XCB_CONFIG_WINDOW_HEIGHT)
+    {
+      values[count] = event->height;
+      count += 1;
+    }
+    if (mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)
+    {
+      values[count] = event->border_width;
+      count += 1;
+    }
+    if (mask & XCB_CONFIG_WINDOW_SIBLING)
+    {
+      values[count] = event->sibling;
+      count += 1;
+    }
+    if (mask & XCB_CONFIG_WINDOW_STACK_MODE)
+    {
+      values[count] = event->stack_mode;
+      count += 1;
+    }
+    xcb_configure_window(g_conn, event->window, mask, values);
+  }
 }
 
 internal bool Xcb_PollEvents()
 {
+  ProfileZone("Xcb_PollEvents");
   bool ok = true;
   for (xcb_generic_event_t *generic_event = xcb_poll_for_event(g_conn); generic_event != NULL;
        generic_event                      = xcb_poll_for_event(g_conn))
   {
-    int event_type = generic_event->response_type & ~0x80;
+    u64         start      = TimeNow();
+    int         event_type = generic_event->response_type & ~0x80;
+    const char *event_name = JournalCodeName(JournalKind_XEvent, (u16)event_type);
+    TraceBegin(event_name[0] != '\0' ? event_name : "XEvent");
     if (event_type != XCB_MOTION_NOTIFY)
     {
       Debugf("Event type %d", event_type);
@@ -230,10 +719,20 @@ internal bool Xcb_PollEvents()
     if (event_type == g_randr_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY)
     {
     }
+    if (event_type == g_xkb_base)
+    {
+      HandleXkbEvent((XkbEvent *)generic_event);
+    }
     // handle errors
     if (event_type == 0)
     {
       xcb_generic_error_t *error = (xcb_generic_error_t *)generic_event;
+      JournalPush((JournalRecord){.start    = start,
+                                 .kind     = JournalKind_XError,
+                                 .code     = error->error_code,
+                                 .sequence = error->sequence,
+                                 .arg0     = error->major_code,
+                                 .arg1     = error->minor_code});
       switch (error->error_code)
       {
 #define _ERROR_BRANCH(branch)                                                                      \
@@ -265,7 +764,237 @@ internal bool Xcb_PollEvents()
     case XCB_MAP_REQUEST:
       HandleMapRequest((xcb_map_request_event_t *)generic_event);
       break;
+    case XCB_KEY_PRESS:
+      ok = HandleKeyPress((xcb_key_press_event_t *)generic_event) && ok;
+      break;
+    case XCB_MAPPING_NOTIFY:
+      HandleMappingNotify((xcb_mapping_notify_event_t *)generic_event);
+      break;
+    case XCB_UNMAP_NOTIFY:
+      HandleUnmapNotify((xcb_unmap_notify_event_t *)generic_event);
+      break;
+    case XCB_DESTROY_NOTIFY:
+      HandleDestroyNotify((xcb_destroy_notify_event_t *)generic_event);
+      break;
+    case XCB_CONFIGURE_REQUEST:
+      HandleConfigureRequest((xcb_configure_request_event_t *)generic_event);
+      break;
+    }
+    // Pointer motion would flush the whole ring within seconds
+    if (event_type != 0 && event_type != XCB_MOTION_NOTIFY)
+    {
+      JournalPush((JournalRecord){.start    = start,
+                                 .duration = JournalSince(start),
+                                 .kind     = JournalKind_XEvent,
+                                 .code     = (u16)event_type,
+                                 .window   = Xcb_EventWindow(generic_event),
+                                 .sequence = generic_event->sequence});
     }
+    free(generic_event);
+    TraceEnd();
   }
   return ok;
+}
+
+internal u64 Xcb_QueueLayout()
+{
+  ProfileZone("Xcb_QueueLayout");
+  // Only shown workspaces are laid out, one per monitor, the journal records passes up to this
+  // many monitors and skips the rest
+  JournalRecord passes[16];
+  u32           passes_count = 0;
+  for (u16 monitor = 0; g_config && MonitorWorkspaces(monitor); monitor += 1)
+  {
+    ArrayWorkspace *workspaces = MonitorWorkspaces(monitor);
+    for (u64 i = 0; i < workspaces->size; i += 1)
+    {
+      u64 start = TimeNow();
+      u64 laid  = WorkspaceLayout(ArenaAllocator(g_windows_arena), &workspaces->data[i],
+                                  &g_config->style, &g_windows);
+      if (laid != 0 && passes_count < sizeof passes / sizeof passes[0])
+      {
+        passes[passes_count] = (JournalRecord){.start    = start,
+                                               .duration = JournalSince(start),
+                                               .kind     = JournalKind_Layout,
+                                               .code     = workspaces->data[i].layout,
+                                               .arg0     = (u32)monitor << 16 | (u32)i,
+                                               .arg1     = (u32)Min(laid, (u64)UINT32_MAX)};
+        passes_count += 1;
+      }
+    }
+  }
+
+  u64                  sent = 0;
+  WindowGeometryChange changes[64];
+  u16                  from = 0;
+  u16                  count;
+  do
+  {
+    count = WindowsSystemGeometryChanges(&g_windows, &from, changes, 64);
+    for (u16 i = 0; i < count; i += 1)
+    {
+      u16 index = changes[i].index;
+      u16 mask  = changes[i].value_mask;
+      // X, Y, WIDTH, HEIGHT and BORDER_WIDTH are mask bits 0 to 4, values go in bit order
+      u32 fields[5] = {(u32)(i32)g_windows.xs[index], (u32)(i32)g_windows.ys[index],
+                       g_windows.widths[index], g_windows.heights[index],
+                       g_windows.borders[index]};
+      u32 values[5];
+      u32 size = 0;
+      for (u32 bit = 0; bit < 5; bit += 1)
+      {
+        if (mask & (1 << bit))
+        {
+          values[size] = fields[bit];
+          size += 1;
+        }
+      }
+      xcb_configure_window(g_conn, g_windows.ids[index], mask, values);
+      WindowsSystemMarkSent(&g_windows, index);
+      sent += 1;
+      u32 workspace = (u32)g_windows.monitors[index] << 16 | g_windows.workspaces[index];
+      for (u32 p = 0; p < passes_count; p += 1)
+      {
+        passes[p].arg2 += passes[p].arg0 == workspace;
+      }
+    }
+  } while (count == 64);
+  for (u32 p = 0; p < passes_count; p += 1)
+  {
+    JournalPush(passes[p]);
+  }
+  return sent;
+}
+
+internal u64 Xcb_Layout()
+{
+  u64 sent = Xcb_QueueLayout();
+  if (sent != 0)
+  {
+    xcb_flush(g_conn);
+  }
+  return sent;
+}
+
+internal void Xcb_MoveFocusedWindowToWorkspace(u16 workspace)
+{
+  ProfileZone("Xcb_MoveFocusedWindowToWorkspace");
+  Allocator allocator = ArenaAllocator(g_windows_arena);
+  u16       monitor   = MonitorActive();
+  u16       active    = MonitorActiveWorkspace(monitor);
+  // Creating a workspace may move the others, so both exist before either pointer is taken
+  if (workspace != active && MonitorWorkspace(allocator, monitor, Max(active, workspace)))
+  {
+    Workspace   *source  = MonitorWorkspace(allocator, monitor, active);
+    Workspace   *target  = MonitorWorkspace(allocator, monitor, workspace);
+    xcb_window_t focused = WorkspaceFocusedWindow(source);
+    i32          index   = focused != 0 ? Xcb_FindManagedWindow(focused) : -1;
+    if (index != -1)
+    {
+      // The membership record says where it is, neither workspace is searched
+      WorkspaceRemoveWindow(source, &g_windows, (u16)index);
+      WorkspaceAddWindow(allocator, target, &g_windows, (u16)index, WindowList_NormalMapped);
+      Xcb_FocusWindow(WorkspaceFocusedWindow(source));
+      Xcb_Layout();
+      xcb_flush(g_conn);
+    }
+  }
+}
+
+internal void Xcb_SwitchToWorkspace(u16 workspace)
+{
+  ProfileZone("Xcb_SwitchToWorkspace");
+  u16 monitor = MonitorActive();
+  if (MonitorSwitchWorkspace(ArenaAllocator(g_windows_arena), monitor, workspace, &g_windows))
+  {
+    // Other clients don't get to draw a frame with both workspaces half moved
+    xcb_grab_server(g_conn);
+    Xcb_QueueLayout();
+    Xcb_FocusWindow(WorkspaceFocusedWindow(Xcb_ActiveWorkspace()));
+    xcb_ewmh_set_current_desktop(&g_ewmh, 0, workspace);
+    xcb_ungrab_server(g_conn);
+    xcb_flush(g_conn);
+  }
+}
+
+internal u64 Xcb_ApplyConfig(const Config *config, const ConfigDiff *diff)
+{
+  ProfileZone("Xcb_ApplyConfig");
+  TraceBegin("Xcb_ApplyConfig");
+  XcbRequestCounters *counters = &g_config_requests;
+  XcbRequestCounters  before   = *counters;
+  g_config                     = config;
+
+  u64 start = TimeNow();
+  for (u64 i = 0; i < diff->bindings_removed.size; i += 1)
+  {
+    KeyBinding *binding = &diff->bindings_removed.data[i];
+    counters->ungrab_key +=
+        KeyboardUngrab(g_conn, g_screen->root, binding->keysym, binding->modifiers);
+  }
+  for (u64 i = 0; i < diff->bindings_added.size; i += 1)
+  {
+    KeyBinding *binding = &diff->bindings_added.data[i];
+    counters->grab_key += KeyboardGrab(g_conn, g_screen->root, binding->keysym, binding->modifiers);
+  }
+  // Every grab went out unchecked, one reply collects all their errors
+  if (counters->grab_key != before.grab_key || counters->ungrab_key != before.ungrab_key)
+  {
+    KeyboardSync(g_conn);
+  }
+  Xcb_BuildKeyTable();
+
+  // Relaid geometry goes out with the border widths below
+  if (diff->relayout)
+  {
+    for (u16 monitor = 0; MonitorWorkspaces(monitor); monitor += 1)
+    {
+      ArrayWorkspace *workspaces = MonitorWorkspaces(monitor);
+      for (u64 i = 0; i < workspaces->size; i += 1)
+      {
+        WorkspaceInvalidate(&workspaces->data[i]);
+      }
+    }
+  }
+  if (diff->border_width || diff->border_colors)
+  {
+    u32 border_pixel = Xcb_PixelFromColor(config->style.border_default_color);
+    for (u16 i = 0; i < g_windows.size; i += 1)
+    {
+      if (g_windows.window_types[i] != WindowType_Docked)
+      {
+        g_windows.borders[i] = (u16)config->style.border_width;
+        if (diff->border_colors)
+        {
+          Xcb_ChangeWindowAttributes(g_windows.ids[i], XCB_CW_BORDER_PIXEL, border_pixel);
+          counters->change_window_attributes += 1;
+        }
+      }
+    }
+  }
+  if (diff->border_colors && g_focused_window != 0)
+  {
+    Xcb_ChangeWindowAttributes(g_focused_window, XCB_CW_BORDER_PIXEL,
+                               Xcb_PixelFromColor(config->style.border_active_color));
+    counters->change_window_attributes += 1;
+  }
+  // Geometry and border widths go out together, only for the windows where they changed
+  counters->configure_window += Xcb_Layout();
+
+  u64 grabs   = counters->grab_key - before.grab_key;
+  u64 ungrabs = counters->ungrab_key - before.ungrab_key;
+  u64 configs = counters->configure_window - before.configure_window;
+  u64 attribs = counters->change_window_attributes - before.change_window_attributes;
+  u64 sent    = grabs + ungrabs + configs + attribs;
+  if (sent != 0)
+  {
+    xcb_flush(g_conn);
+  }
+  u64 elapsed = (TimeNow() - start) / Microsecons(1);
+  Infof("Config: applied with %llu requests (%llu grabs, %llu ungrabs, %llu configures, "
+        "%llu attribute changes) in %llu us",
+        (unsigned long long)sent, (unsigned long long)grabs, (unsigned long long)ungrabs,
+        (unsigned long long)configs, (unsigned long long)attribs, (unsigned long long)elapsed);
+  TraceEnd();
+  return sent;
 }
\ No newline at end of file
@@ -3,15 +3,59 @@
 
 #include "../core/core.h"
 #include "window.h"
+#include "config.h"
 #include <xcb/xproto.h>
 
 internal bool Xcb_Init(Allocator allocator, String wm_name);
 internal void Xcb_Deinit();
+/*
+Sends buffered requests, returns the connection's file descriptor to wait on
+*/
+internal int  Xcb_Flush();
 
 internal void Xcb_ChangeWindowAttributes(xcb_window_t window, int value_mask, int value);
 
 internal WindowType Xcb_WindowType(xcb_window_t window);
 
 internal bool Xcb_PollEvents();
+/*
+Lays out every dirty workspace, then diffs the geometry of every window against what was last
+sent and configures only the fields that changed, all in one flush. Returns the number of
+requests sent.
+*/
+internal u64  Xcb_Layout();
+/*
+Xcb_Layout without the flush, for callers batching more requests behind it
+*/
+internal u64  Xcb_QueueLayout();
+/*
+Shows the workspace on the active monitor. Hidden windows are parked off-screen rather than
+unmapped, and the geometry, the focus and _NET_CURRENT_DESKTOP go out under one server grab in a
+single flush.
+*/
+internal void Xcb_SwitchToWorkspace(u16 workspace);
+/*
+Moves the focused tiled window of the active workspace to another workspace of the same monitor,
+where it is parked until that workspace is shown. Focus stays on the active workspace.
+*/
+internal void Xcb_MoveFocusedWindowToWorkspace(u16 workspace);
+
+/*
+Requests sent while applying config snapshots, by kind
+*/
+typedef struct
+{
+  u64 grab_key;
+  u64 ungrab_key;
+  u64 change_window_attributes;
+  u64 configure_window;
+} XcbRequestCounters;
+
+/*
+Brings the server in line with a new config snapshot, sending only what the diff calls for.
+The snapshot stays in use for newly managed windows until the next call.
+Returns the number of requests sent, zero for a reload that changed nothing.
+*/
+internal u64 Xcb_ApplyConfig(const Config *config, const ConfigDiff *diff);
 
 #endif
\ No newline at end of file